@@ -4,7 +4,7 @@ import numpy as np
 import matplotlib.pyplot as plt
 
 # ---------- Import approximate algorithms ----------
-from algorithms import (
+from kemeny_native import (
     borda,
     copeland,
     footrule_optimal,
@@ -28,6 +28,9 @@ from dataset_generator import (
     generate_uniform,
 )
 
+# ---------- kemeny_bench results ----------
+from bench_loader import load_bench, bench_series
+
 # -------------------------------------------
 def time_algorithm(func, ranks, repeats=1, **kwargs):
     """
@@ -63,6 +66,36 @@ def choose_dataset(name, n_voters, n_cands):
         raise ValueError(f"Unknown dataset type: {name}")
 
 
+# -------------------------------------------
+def plot_native(path, dataset, n_voters):
+    """
+    Plot the medians measured by kemeny_bench (JSON lines at path)
+    instead of timing the Python calls here.
+    """
+    records = load_bench(path)
+
+    plt.figure(figsize=(10, 6))
+    for method, label in [("borda", "Borda"),
+                          ("copeland", "Copeland"),
+                          ("rankedpairs", "Ranked Pairs"),
+                          ("multistart", "Local Search"),
+                          ("schulze", "Schulze"),
+                          ("kwiksort", "KwikSort")]:
+        sizes, seconds = bench_series(records, method, dataset, n_voters)
+        plt.plot(sizes, seconds, label=label)
+
+    plt.xlabel("Number of Candidates (k)")
+    plt.ylabel("Median runtime (seconds, log scale)")
+    plt.yscale("log")
+    plt.title(f"Approximate Algorithms Runtime on {dataset} Dataset (native)")
+    plt.legend()
+    plt.grid(True)
+    plt.tight_layout()
+    plt.savefig("approx_runtime.png")
+
+    print("\nPlot saved as approx_runtime.png")
+
+
 # -------------------------------------------
 def main():
 
@@ -70,6 +103,11 @@ def main():
     DATASET = "uniform"      # choose dataset type
     N_VOTERS = 2000          # total voters
     MAX_CANDS = 150          # approximate methods scale well
+    NATIVE_BENCH = None      # kemeny_bench JSON run with --voters N_VOTERS: plot it instead
+
+    if NATIVE_BENCH:
+        plot_native(NATIVE_BENCH, DATASET, N_VOTERS)
+        return
 
     print(f"Dataset = {DATASET}, Voters = {N_VOTERS}")
 
@@ -0,0 +1,36 @@
+# bench_loader.py
+import json
+
+
+def load_bench(path):
+    """
+    Load the JSON lines written by kemeny_bench (legacy c code/kemeny_bench.c)
+    into a list of dicts, one per method and election.
+    """
+    records = []
+    with open(path, "r", encoding="utf-8") as f:
+        for line in f:
+            line = line.strip()
+            if line:
+                records.append(json.loads(line))
+    return records
+
+
+def bench_series(records, method, source, n_voters=None, stat="median_ms"):
+    """
+    Runtime of one C method against the number of candidates on one
+    generator model ("uniform", "mallows", "pl", "cycle"), for plotting.
+
+    Returns (candidate_sizes, seconds): the sizes in increasing order and
+    the chosen statistic ("median_ms", "p95_ms", ...) in seconds, NaN where
+    the method could not run. If n_voters is None, the largest voter count
+    benchmarked is used.
+    """
+    rows = [r for r in records if r["method"] == method and r["source"] == source]
+    if n_voters is None and rows:
+        n_voters = max(r["voters"] for r in rows)
+    rows = sorted((r for r in rows if r["voters"] == n_voters), key=lambda r: r["candidates"])
+
+    sizes = [r["candidates"] for r in rows]
+    seconds = [r[stat] / 1000.0 if r[stat] is not None else float("nan") for r in rows]
+    return sizes, seconds
@@ -4,7 +4,7 @@ import numpy as np
 import matplotlib.pyplot as plt
 
 from soc_loader import load_soc_strict_orders
-from algorithms import (
+from kemeny_native import (
     kemeny_young_exact,
     borda,
     copeland,
@@ -4,7 +4,7 @@ import matplotlib.pyplot as plt
 from dataset_generator import generate_uniform, generate_cycle_heavy, generate_adversarial_bad_case
 from soc_loader import load_soc_strict_orders
 
-from algorithms import (
+from kemeny_native import (
     kemeny_young_exact,
     borda,
     copeland,
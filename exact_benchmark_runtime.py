@@ -4,7 +4,7 @@ import numpy as np
 import matplotlib.pyplot as plt
 
 # import your algorithms
-from algorithms import (
+from kemeny_native import (
     kemeny_young_exact,
     kemeny_bruteforce,
     kemeny_dp_by_candidates,
@@ -21,6 +21,9 @@ from dataset_generator import (
     generate_uniform,
 )
 
+# kemeny_bench results
+from bench_loader import load_bench, bench_series
+
 # ----------------------------------------------------------
 def time_algorithm(func, ranks, repeats=1, **kwargs):
     """
@@ -57,12 +60,44 @@ def choose_dataset(name, n_voters, n_cands):
         raise ValueError(f"Unknown dataset type: {name}")
 
 
+# ----------------------------------------------------------
+def plot_native(path, dataset, n_voters):
+    """
+    Plot the medians measured by kemeny_bench (JSON lines at path)
+    instead of timing the Python calls here.
+    """
+    records = load_bench(path)
+
+    plt.figure(figsize=(10, 6))
+    for method, label in [("bnb", "Kemeny branch and bound (exact)"),
+                          ("bruteforce", "Kemeny Brute Force (m!)"),
+                          ("dp", "Kemeny DP (2ᵐ)")]:
+        sizes, seconds = bench_series(records, method, dataset, n_voters)
+        plt.plot(sizes, seconds, label=label)
+
+    plt.xlabel("Number of Candidates (k)")
+    plt.ylabel("Median runtime (seconds, log scale)")
+    plt.yscale("log")
+    plt.title(f"Exact Kemeny Runtime on {dataset} Dataset (native)")
+    plt.legend()
+    plt.grid(True)
+    plt.tight_layout()
+    plt.savefig("exact_kemeny_runtime.png")
+
+    print("\nPlot saved as exact_kemeny_runtime.png")
+
+
 # ----------------------------------------------------------
 def main():
     # ---- SETTINGS ----
     DATASET = "uniform"
     N_VOTERS = 1000       # normally 200–1000 is enough for exact benchmarking
     MAX_CANDS = 25       # exact algorithms blow up if too large
+    NATIVE_BENCH = None  # kemeny_bench JSON run with --voters N_VOTERS: plot it instead
+
+    if NATIVE_BENCH:
+        plot_native(NATIVE_BENCH, DATASET, N_VOTERS)
+        return
 
     print(f"Dataset = {DATASET}, Voters = {N_VOTERS}")
 
@@ -0,0 +1,107 @@
+# kemeny_native.py
+"""
+Native (C) versions of the methods in algorithms.py.
+
+Build the extension once with
+
+    cd "legacy c code" && python3 setup.py build_ext --inplace
+
+Every name of algorithms.py is re-exported, and the ones with a C
+implementation are replaced by thin wrappers that hand the `ranks`
+array (voters x candidates, ranks[v, c] = position of candidate c,
+lower is better) to the extension without copying it. They keep the
+signatures and return conventions of algorithms.py, so a driver only
+changes its import. If the extension has not been built, everything
+falls back to algorithms.py and NATIVE is False.
+
+Borda and the footrule ranking stay in NumPy: they are already one
+vectorized pass, and the C "borda" method scores winning margins
+rather than positions.
+
+Copeland, Ranked Pairs and Schulze are not replaced, because the C
+methods define them differently: C Copeland counts a tie as half a
+win, C Schulze's paths use strict-majority margins rather than raw
+pairwise counts, and C Ranked Pairs never locks a tied pair and
+breaks equal strengths its own way. They are available as
+copeland_native, ranked_pairs_native and schulze_native, for drivers
+that want the C definitions.
+"""
+import os
+import sys
+
+import numpy as np
+
+from algorithms import *  # noqa: F401,F403  (the pure-Python fallbacks)
+
+try:
+    import _kemeny
+except ImportError:
+    sys.path.insert(0, os.path.join(os.path.dirname(os.path.abspath(__file__)), "legacy c code"))
+    try:
+        import _kemeny
+    except ImportError:
+        _kemeny = None
+
+NATIVE = _kemeny is not None
+
+
+def _ranks(ranks):
+    # The extension reads any integer array through its strides; other
+    # dtypes (e.g. float positions) need one conversion
+    ranks = np.asarray(ranks)
+    if ranks.dtype.kind not in "iu":
+        ranks = ranks.astype(np.int64)
+    return ranks
+
+
+def native_solve(method, ranks, **options):
+    """
+    Run one C method (see methods()) on ranks.
+    Returns (order, disagreements): the candidate indices best first as a
+    read-only NumPy view of the native result, and the Kemeny objective
+    as the number of pairwise disagreements (exact for strict ballots).
+    """
+    ranks = _ranks(ranks)
+    order, score = _kemeny.solve(method, ranks, **options)
+    n_voters, n = ranks.shape
+    disagreements = (n_voters * n * (n - 1) // 2 - score) // 2
+    return np.frombuffer(order, dtype=np.intc), disagreements
+
+
+def methods():
+    return _kemeny.methods() if NATIVE else []
+
+
+if NATIVE:
+    Election = _kemeny.Election
+
+    def kemeny_young_exact(ranks):
+        # Branch and bound without a node limit is exact
+        order, obj = native_solve("bnb", ranks, node_limit=0)
+        return obj, order, obj
+
+    def kemeny_dp_by_candidates(ranks):
+        if np.asarray(ranks).shape[1] == 0:
+            return 0, []
+        order, obj = native_solve("dp", ranks)
+        return int(obj), list(order)
+
+    def kemeny_bruteforce(ranks):
+        return list(native_solve("bruteforce", ranks)[0])
+
+    def copeland_native(ranks):
+        return native_solve("copeland", ranks)[0]
+
+    def ranked_pairs_native(ranks):
+        return native_solve("rankedpairs", ranks)[0]
+
+    def schulze_native(ranks):
+        return native_solve("schulze", ranks)[0]
+
+    def kwiksort_aggregation(ranks):
+        return list(native_solve("kwiksort", ranks)[0])
+
+    def kemeny_local_search(ranks, max_restarts=20, max_iters_no_improve=2000):
+        # The C local search stops at a local optimum by itself, so the
+        # iteration cap has no counterpart
+        return native_solve("multistart", ranks, restarts=max_restarts)[0]
@@ -0,0 +1,412 @@
+// batch.c
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <pthread.h>
+#include "ranksfile.h"
+
+#ifndef _WIN32
+#include <dirent.h>
+#include <sys/stat.h>
+#endif
+
+//----------------------------------------------------------
+// Batch mode
+//----------------------------------------------------------
+// Runs the selected methods on many elections: every PrefLib
+// file and election cache (.kmc) under the given directories,
+// plus the files listed in manifests (one path per line,
+// relative to the manifest; '#' starts a comment). Each
+// election gets one JSON record on its own line, written as
+// soon as it is done:
+//
+//   {"file": ..., "candidates": n, "voters": v, "load_ms": t,
+//    "methods": [{"method": ..., "score": s, "ms": t,
+//                 "ranking": [names, best first]}, ...]}
+//
+// "score" is null when a method cannot run on the election
+// (e.g. brute force on too many candidates), and a file that
+// cannot be read gets {"file": ..., "error": ...}.
+//
+// Elections are scheduled by size, estimated from the file
+// size. Files of at least BATCH_LARGE_BYTES go first, one at
+// a time, each with every thread: the parallel matrix build
+// and the multithreaded solvers split them internally. The
+// rest are packed onto a work-stealing pool. Jobs are dealt
+// round-robin, largest first, onto one deque per worker; a
+// worker takes its own jobs from the front and, when it runs
+// out, steals from the back of the others' deques, so the
+// small elections at the end even out the load. Each of
+// these elections is loaded and solved single-threaded.
+//----------------------------------------------------------
+
+#define BATCH_LARGE_BYTES ((long long)8 << 20)
+
+typedef struct {
+    char *path;
+    long long size;       // File size in bytes, the cost estimate
+} BatchJob;
+
+typedef struct {
+    BatchJob *jobs;
+    int njobs, cap;
+} JobList;
+
+// One worker's jobs: indices into the job list
+typedef struct {
+    int *items;
+    int head, tail;       // Pending items are items[head .. tail)
+    pthread_mutex_t lock;
+} JobDeque;
+
+typedef struct {
+    const JobList *list;
+    JobDeque *deques;
+    int nworkers;
+    const KemenyMethod **sel;
+    int nsel;
+    FILE *out;
+    pthread_mutex_t *outlock;
+} BatchPool;
+
+typedef struct {
+    BatchPool *pool;
+    int worker;
+    int failed;           // Elections this worker could not read
+} BatchWorker;
+
+static int add_job(JobList *jl, const char *path, long long size) {
+    if (jl->njobs == jl->cap) {
+        int cap = jl->cap ? 2 * jl->cap : 64;
+        BatchJob *bigger = realloc(jl->jobs, cap * sizeof(BatchJob));
+        if (!bigger) return 0;
+        jl->jobs = bigger;
+        jl->cap = cap;
+    }
+    char *copy = malloc(strlen(path) + 1);
+    if (!copy) return 0;
+    strcpy(copy, path);
+    jl->jobs[jl->njobs++] = (BatchJob){ copy, size };
+    return 1;
+}
+
+static long long file_size(const char *path) {
+    FILE *f = fopen(path, "rb");
+    if (!f) return -1;
+    long long size = -1;
+    if (fseek(f, 0, SEEK_END) == 0) size = ftell(f);
+    fclose(f);
+    return size;
+}
+
+//----------------------------------------------------------
+// Collecting the elections
+//----------------------------------------------------------
+
+// Adds the PrefLib and cache files under dir, recursively; 0 if dir
+// cannot be listed
+static int add_directory(JobList *jl, const char *dir) {
+#ifndef _WIN32
+    DIR *d = opendir(dir);
+    if (!d) return 0;
+    struct dirent *e;
+    while ((e = readdir(d)) != NULL) {
+        if (strcmp(e->d_name, ".") == 0 || strcmp(e->d_name, "..") == 0) continue;
+        size_t len = strlen(dir) + strlen(e->d_name) + 2;
+        char *path = malloc(len);
+        if (!path) break;
+        snprintf(path, len, "%s/%s", dir, e->d_name);
+
+        struct stat st;
+        if (stat(path, &st) == 0) {
+            if (S_ISDIR(st.st_mode)) add_directory(jl, path);
+            else if (S_ISREG(st.st_mode) && (is_preflib_path(path) || is_cache_path(path)))
+                add_job(jl, path, st.st_size);
+        }
+        free(path);
+    }
+    closedir(d);
+    return 1;
+#else
+    fprintf(stderr, "%s: directories cannot be listed here, use a manifest\n", dir);
+    return 0;
+#endif
+}
+
+// Adds the files listed in the manifest at path; 0 if it
+// cannot be read
+static int add_manifest(JobList *jl, const char *path) {
+    MappedFile in;
+    if (!map_file(path, &in)) return 0;
+
+    const char *slash = strrchr(path, '/');
+    int dirlen = slash ? (int)(slash - path) + 1 : 0;   // Directory part, with its slash
+    const char *p = in.data, *end = in.data + in.len;
+    while (p < end) {
+        const char *line = p;
+        while (p < end && *p != '\n') p++;
+        const char *stop = p;
+        if (p < end) p++;
+
+        while (line < stop && (*line == ' ' || *line == '\t')) line++;
+        while (stop > line && (stop[-1] == ' ' || stop[-1] == '\t' || stop[-1] == '\r')) stop--;
+        if (line == stop || *line == '#') continue;
+
+        int rel = *line != '/';
+        size_t len = (rel ? dirlen : 0) + (size_t)(stop - line) + 1;
+        char *entry = malloc(len);
+        if (!entry) break;
+        snprintf(entry, len, "%.*s%.*s", rel ? dirlen : 0, path, (int)(stop - line), line);
+        add_job(jl, entry, file_size(entry));
+        free(entry);
+    }
+    unmap_file(&in);
+    return 1;
+}
+
+// Adds the elections named by inputs (directories,
+// manifests or election files); 0 (and jl left empty) if
+// one cannot be listed
+static int collect_jobs(JobList *jl, const char **inputs, int ninputs) {
+    int ok = 1;
+    for (int i = 0; i < ninputs; i++) {
+        int listed;
+#ifndef _WIN32
+        struct stat st;
+        if (stat(inputs[i], &st) == 0 && S_ISDIR(st.st_mode)) listed = add_directory(jl, inputs[i]);
+        else
+#endif
+        if (is_preflib_path(inputs[i]) || is_cache_path(inputs[i]))
+            listed = add_job(jl, inputs[i], file_size(inputs[i]));
+        else listed = add_manifest(jl, inputs[i]);
+        if (!listed) {
+            fprintf(stderr, "Cannot list %s\n", inputs[i]);
+            ok = 0;
+        }
+    }
+    if (!ok) {
+        for (int j = 0; j < jl->njobs; j++) free(jl->jobs[j].path);
+        free(jl->jobs);
+        memset(jl, 0, sizeof(JobList));
+    }
+    return ok;
+}
+
+// Largest first, then by path
+static int by_size_desc(const void *a, const void *b) {
+    const BatchJob *x = a, *y = b;
+    if (x->size != y->size) return (x->size < y->size) ? 1 : -1;
+    return strcmp(x->path, y->path);
+}
+
+static int by_path(const void *a, const void *b) {
+    return strcmp(((const BatchJob *)a)->path, ((const BatchJob *)b)->path);
+}
+
+//----------------------------------------------------------
+// Function: kemeny_list_elections
+//----------------------------------------------------------
+// The election files batch mode would run for inputs, sorted
+// by path, in a new array *paths of new strings (the caller
+// frees both). Returns their number, or -1 if an input
+// cannot be listed.
+//----------------------------------------------------------
+int kemeny_list_elections(const char **inputs, int ninputs, char ***paths) {
+    JobList jl = { NULL, 0, 0 };
+    if (!collect_jobs(&jl, inputs, ninputs)) return -1;
+    qsort(jl.jobs, jl.njobs, sizeof(BatchJob), by_path);
+
+    *paths = malloc((jl.njobs > 0 ? jl.njobs : 1) * sizeof(char *));
+    if (!*paths) {
+        for (int j = 0; j < jl.njobs; j++) free(jl.jobs[j].path);
+        free(jl.jobs);
+        return -1;
+    }
+    for (int j = 0; j < jl.njobs; j++) (*paths)[j] = jl.jobs[j].path;
+    free(jl.jobs);
+    return jl.njobs;
+}
+
+//----------------------------------------------------------
+// Function: json_string
+//----------------------------------------------------------
+// Writes s to out as a JSON string literal: quotes and
+// backslashes escaped, control characters as \u00XX.
+//----------------------------------------------------------
+void json_string(FILE *out, const char *s) {
+    fputc('"', out);
+    for (; *s; s++) {
+        unsigned char c = (unsigned char)*s;
+        if (c == '"' || c == '\\') fprintf(out, "\\%c", c);
+        else if (c < 0x20) fprintf(out, "\\u%04x", c);
+        else fputc(c, out);
+    }
+    fputc('"', out);
+}
+
+//----------------------------------------------------------
+// One election
+//----------------------------------------------------------
+
+// Loads and solves one election and writes its record;
+// returns 0 if it could not be read
+static int run_job(const BatchJob *job, const KemenyMethod **sel, int nsel, FILE *out,
+                   pthread_mutex_t *outlock) {
+    double t0 = monotonic_ms();
+    RanksFile *rf = read_election(job->path, NULL, 0);
+    double load_ms = monotonic_ms() - t0;
+
+    if (!rf) {
+        pthread_mutex_lock(outlock);
+        fprintf(out, "{\"file\": ");
+        json_string(out, job->path);
+        fprintf(out, ", \"error\": \"cannot read or parse the election\"}\n");
+        fflush(out);
+        pthread_mutex_unlock(outlock);
+        return 0;
+    }
+
+    // Solve everything first, so the record is written in one go
+    int n = rf->ncands, sz = n > 0 ? n : 1;
+    int *perms = malloc((size_t)nsel * sz * sizeof(int));
+    long long *scores = malloc((nsel > 0 ? nsel : 1) * sizeof(long long));
+    double *ms = malloc((nsel > 0 ? nsel : 1) * sizeof(double));
+    if (!perms || !scores || !ms) {
+        fprintf(stderr, "Out of memory for the results of %s\n", job->path);
+        exit(1);
+    }
+    for (int m = 0; m < nsel; m++) {
+        t0 = monotonic_ms();
+        scores[m] = kemeny_method_solve(rf, sel[m], &perms[(size_t)m * sz]);
+        ms[m] = monotonic_ms() - t0;
+    }
+
+    pthread_mutex_lock(outlock);
+    fprintf(out, "{\"file\": ");
+    json_string(out, job->path);
+    fprintf(out, ", \"candidates\": %d, \"voters\": %d, \"load_ms\": %.3f, \"methods\": [",
+            n, rf->nrankers, load_ms);
+    for (int m = 0; m < nsel; m++) {
+        fprintf(out, "%s{\"method\": \"%s\", ", m ? ", " : "", sel[m]->name);
+        if (scores[m] == KEMENY_NO_SCORE) {
+            fprintf(out, "\"score\": null, \"ms\": %.3f}", ms[m]);
+            continue;
+        }
+        fprintf(out, "\"score\": %lld, \"ms\": %.3f, \"ranking\": [", scores[m], ms[m]);
+        for (int i = 0; i < n; i++) {
+            if (i) fprintf(out, ", ");
+            json_string(out, rf->unnames[perms[(size_t)m * sz + i]]);
+        }
+        fprintf(out, "]}");
+    }
+    fprintf(out, "]}\n");
+    fflush(out);
+    pthread_mutex_unlock(outlock);
+
+    free(perms);
+    free(scores);
+    free(ms);
+    ranksfile_destroy(rf);
+    return 1;
+}
+
+//----------------------------------------------------------
+// Work-stealing pool
+//----------------------------------------------------------
+
+// Next job for worker w: its own front, else another's back
+static int next_job(BatchPool *pool, int w) {
+    for (int k = 0; k < pool->nworkers; k++) {
+        JobDeque *d = &pool->deques[(w + k) % pool->nworkers];
+        int job = -1;
+        pthread_mutex_lock(&d->lock);
+        if (d->head < d->tail) job = (k == 0) ? d->items[d->head++] : d->items[--d->tail];
+        pthread_mutex_unlock(&d->lock);
+        if (job >= 0) return job;
+    }
+    return -1;
+}
+
+static void *batch_worker(void *arg) {
+    BatchWorker *bw = arg;
+    BatchPool *pool = bw->pool;
+    int job;
+    while ((job = next_job(pool, bw->worker)) >= 0)
+        bw->failed += !run_job(&pool->list->jobs[job], pool->sel, pool->nsel, pool->out, pool->outlock);
+    return NULL;
+}
+
+//----------------------------------------------------------
+// Function: kemeny_batch
+//----------------------------------------------------------
+// Runs the methods sel[0..nsel) on every election named by
+// inputs (directories, manifests or election files), with
+// kemeny_default_options.nthreads threads, writing one JSON
+// line per election to out. Returns the number of elections
+// that could not be read, or -1 if an input cannot be
+// listed.
+//----------------------------------------------------------
+int kemeny_batch(const char **inputs, int ninputs, const KemenyMethod **sel, int nsel, FILE *out) {
+    JobList jl = { NULL, 0, 0 };
+    int failed = 0;
+
+    if (!collect_jobs(&jl, inputs, ninputs)) return -1;
+    qsort(jl.jobs, jl.njobs, sizeof(BatchJob), by_size_desc);
+
+    RanksFile probe = { .opts = kemeny_default_options };
+    int nthreads = ranksfile_threads(&probe);
+    int saved = kemeny_default_options.nthreads;
+    pthread_mutex_t outlock = PTHREAD_MUTEX_INITIALIZER;
+    double t0 = monotonic_ms();
+
+    // Large elections: one at a time, parallel inside
+    int nlarge = 0;
+    kemeny_default_options.nthreads = nthreads;
+    while (nlarge < jl.njobs && (nthreads == 1 || jl.jobs[nlarge].size >= BATCH_LARGE_BYTES)) {
+        failed += !run_job(&jl.jobs[nlarge], sel, nsel, out, &outlock);
+        nlarge++;
+    }
+
+    // The rest: one thread each, spread over the pool
+    int nworkers = jl.njobs - nlarge < nthreads ? jl.njobs - nlarge : nthreads;
+    if (nworkers > 0) {
+        kemeny_default_options.nthreads = 1;
+        int per = (jl.njobs - nlarge + nworkers - 1) / nworkers;   // Most jobs one deque gets
+        JobDeque *deques = calloc(nworkers, sizeof(JobDeque));
+        BatchWorker *workers = calloc(nworkers, sizeof(BatchWorker));
+        int *items = malloc((size_t)nworkers * per * sizeof(int));
+        if (!deques || !workers || !items) {
+            fprintf(stderr, "Out of memory for %d elections!\n", jl.njobs);
+            exit(1);
+        }
+
+        BatchPool pool = { &jl, deques, nworkers, sel, nsel, out, &outlock };
+        for (int w = 0; w < nworkers; w++) {
+            deques[w].items = &items[w * per];
+            pthread_mutex_init(&deques[w].lock, NULL);
+            workers[w] = (BatchWorker){ &pool, w, 0 };
+        }
+        for (int j = nlarge; j < jl.njobs; j++) {
+            JobDeque *d = &deques[(j - nlarge) % nworkers];
+            d->items[d->tail++] = j;
+        }
+
+        run_parallel(batch_worker, workers, sizeof(BatchWorker), nworkers);
+        for (int w = 0; w < nworkers; w++) {
+            failed += workers[w].failed;
+            pthread_mutex_destroy(&deques[w].lock);
+        }
+        free(items);
+        free(workers);
+        free(deques);
+    }
+    kemeny_default_options.nthreads = saved;
+
+    fprintf(stderr, "Batch: %d elections in %.1f ms on %d threads", jl.njobs, monotonic_ms() - t0, nthreads);
+    if (failed) fprintf(stderr, " (%d could not be read)", failed);
+    fprintf(stderr, "\n");
+
+    for (int j = 0; j < jl.njobs; j++) free(jl.jobs[j].path);
+    free(jl.jobs);
+    return failed;
+}
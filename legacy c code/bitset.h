@@ -0,0 +1,36 @@
+#ifndef BITSET_H
+#define BITSET_H
+
+#include <stdint.h>
+
+// Fixed-size bitsets stored as rows of 64-bit words. A set
+// over n elements takes BITSET_WORDS(n) words; bit i lives
+// in word i / 64. Used for reachability and win/tie rows
+// over candidates.
+#define BITSET_WORDS(n) (((n) + 63) / 64)
+
+static inline int bit_test(const uint64_t *row, int i) {
+    return (row[i >> 6] >> (i & 63)) & 1;
+}
+
+static inline void bit_set(uint64_t *row, int i) {
+    row[i >> 6] |= (uint64_t)1 << (i & 63);
+}
+
+static inline void bit_clear(uint64_t *row, int i) {
+    row[i >> 6] &= ~((uint64_t)1 << (i & 63));
+}
+
+// dst |= src
+static inline void bitset_or(uint64_t *dst, const uint64_t *src, int nwords) {
+    for (int w = 0; w < nwords; w++) dst[w] |= src[w];
+}
+
+// Number of bits set
+static inline int bitset_count(const uint64_t *row, int nwords) {
+    int c = 0;
+    for (int w = 0; w < nwords; w++) c += __builtin_popcountll(row[w]);
+    return c;
+}
+
+#endif
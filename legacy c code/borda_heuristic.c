@@ -3,6 +3,34 @@
 #include <string.h>
 #include "ranksfile.h"
 
+// Candidates by descending Borda score, NULL if out of memory.
+// Each candidate scores its winning margins, summed once per
+// election in the majority tournament.
+static KeyedCand *borda_ranking(RanksFile *rf) {
+    int n = rf->ncands;
+    const Tournament *t = ranksfile_tournament(rf);
+    KeyedCand *ranking = malloc((n > 0 ? n : 1) * sizeof(KeyedCand));
+    if (!t || !ranking) {
+        free(ranking);
+        return NULL;
+    }
+    for (int i = 0; i < n; i++) ranking[i] = (KeyedCand){ t->borda[i], i };
+    sort_keyed_desc(ranking, n);
+    return ranking;
+}
+
+// Fills perm with the Borda ranking and returns its Kemeny
+// score, or KEMENY_NO_SCORE if out of memory
+long long borda_solve(RanksFile *rf, int *perm) {
+    int n = rf->ncands;
+    KeyedCand *ranking = borda_ranking(rf);
+    if (!ranking) return KEMENY_NO_SCORE;
+
+    for (int i = 0; i < n; i++) perm[i] = ranking[i].cand;
+    free(ranking);
+    return ranking_score(rf, perm);
+}
+
 // Compute an approximate Kemeny consensus using the Borda Count heuristic
 void compute_borda_heuristic(RanksFile *rf, FILE *outfile) {
     int n = rf->ncands;
@@ -13,38 +41,18 @@ void compute_borda_heuristic(RanksFile *rf, FILE *outfile) {
         return;
     }
 
-    // Array for storing Borda scores
-    double scores[MAXCANDS] = {0};
-
-    // Compute scores using the preference matrix
-    // Each candidate gets 1 point for every other candidate it beats
-    for (int i = 0; i < n; i++) {
-        for (int j = 0; j < n; j++) {
-            if (i != j && rf->prefmat[i][j] > 0) {
-                scores[i] += rf->prefmat[i][j];
-            }
-        }
-    }
-
-    // Array to keep candidate indices
-    int ranking[MAXCANDS];
-    for (int i = 0; i < n; i++) ranking[i] = i;
-
-    // Sort candidates by descending Borda score (simple bubble sort)
-    for (int i = 0; i < n - 1; i++) {
-        for (int j = i + 1; j < n; j++) {
-            if (scores[ranking[j]] > scores[ranking[i]]) {
-                int tmp = ranking[i];
-                ranking[i] = ranking[j];
-                ranking[j] = tmp;
-            }
-        }
+    KeyedCand *ranking = borda_ranking(rf);
+    if (!ranking) {
+        fprintf(outfile, "Borda: out of memory.\n");
+        return;
     }
 
     // Output results
     fprintf(outfile, "\nBorda Count Heuristic Ranking:\n");
     for (int i = 0; i < n; i++) {
         fprintf(outfile, "%d. %s (score = %.2f)\n", i + 1,
-                rf->unnames[ranking[i]], scores[ranking[i]]);
+                rf->unnames[ranking[i].cand], (double)ranking[i].key);
     }
+
+    free(ranking);
 }
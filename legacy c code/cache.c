@@ -0,0 +1,277 @@
+// cache.c
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stddef.h>
+#include <stdint.h>
+#include "ranksfile.h"
+
+//----------------------------------------------------------
+// Binary election cache (.kmc)
+//----------------------------------------------------------
+// Everything the solvers need from an election is its
+// candidate names, its voter counts and the pairwise margins,
+// so a parsed election can be saved once and every later run
+// skips the ballots. The file is laid out to be mapped and
+// used in place:
+//
+//     CacheHeader                     fixed size, see below
+//     names                           NUL-terminated, in index order
+//     (zero padding to CACHELINE)
+//     margins                         the packed triangle of margin.c,
+//                                     int16 or int32 per entry
+//
+// The margins are exactly MarginMatrix.tri, so a loaded
+// RanksFile points its margins into the mapping instead of
+// copying them; only the dense prefmat (n^2 ints) is expanded
+// from them. Loading costs O(n^2) in the candidates and
+// nothing in the voters or ballots.
+//
+// The header carries its own checksum and one over the names
+// and margins. Files are written in native byte order and a
+// byte-order mark rejects files from a machine of the other
+// endianness. Bump CACHE_VERSION whenever the layout changes.
+//----------------------------------------------------------
+
+#define CACHE_MAGIC "KEMCACHE"
+#define CACHE_VERSION 1
+#define CACHE_BOM 0x01020304u
+
+typedef struct {
+    char magic[8];            // CACHE_MAGIC
+    uint32_t version;         // CACHE_VERSION
+    uint32_t bom;             // CACHE_BOM as written
+    int32_t ncands;           // Number of candidates
+    int32_t nrankers;         // Number of voters
+    int32_t nballots;         // Number of distinct ballots read, -1 if unknown (merged)
+    int32_t width;            // Bytes per margin: 2 or 4
+    int64_t nprefs;           // Pairwise preferences recorded
+    uint64_t names_off;       // Offset of the names
+    uint64_t names_len;       // Their total length, NULs included
+    uint64_t tri_off;         // Offset of the margins (CACHELINE-aligned)
+    uint64_t tri_len;         // Their length in bytes
+    uint64_t payload_sum;     // Checksum of the names, then the margins
+    uint64_t header_sum;      // Checksum of the fields above
+} CacheHeader;
+
+int is_cache_path(const char *path) {
+    const char *dot = strrchr(path, '.');
+    return dot && strcmp(dot, CACHE_EXT) == 0;
+}
+
+//----------------------------------------------------------
+// Helper: checksum
+//----------------------------------------------------------
+// 64-bit FNV-style hash taken a word at a time, continuing
+// from h. It only has to catch truncated or damaged files,
+// so it is built for speed rather than strength.
+//----------------------------------------------------------
+static uint64_t checksum(uint64_t h, const void *data, size_t len) {
+    const unsigned char *p = data;
+    size_t i = 0;
+    for (; i + 8 <= len; i += 8) {
+        uint64_t w;
+        memcpy(&w, p + i, 8);
+        h = (h ^ w) * 0x100000001B3ULL;
+        h ^= h >> 32;
+    }
+    for (; i < len; i++) h = (h ^ p[i]) * 0x100000001B3ULL;
+    return h;
+}
+
+#define CHECKSUM_SEED 0xCBF29CE484222325ULL
+
+static uint64_t header_checksum(const CacheHeader *h) {
+    return checksum(CHECKSUM_SEED, h, offsetof(CacheHeader, header_sum));
+}
+
+//----------------------------------------------------------
+// Function: write_cache_file
+//----------------------------------------------------------
+// Saves rf (names, counts and margins) to path. The file is
+// written under a temporary name and renamed into place, so
+// a reader never maps a half-written cache. Builds rf's
+// margin matrix if it has none yet. Returns 1 on success,
+// 0 if memory runs out or path cannot be written.
+//----------------------------------------------------------
+int write_cache_file(RanksFile *rf, const char *path) {
+    const MarginMatrix *mm = ranksfile_margins(rf);
+    if (!mm) return 0;
+
+    int n = rf->ncands;
+    size_t names_len = 0;
+    for (int i = 0; i < n; i++) names_len += strlen(rf->unnames[i]) + 1;
+    char *names = malloc(names_len > 0 ? names_len : 1);
+    if (!names) return 0;
+    size_t pos = 0;
+    for (int i = 0; i < n; i++) {
+        size_t len = strlen(rf->unnames[i]) + 1;
+        memcpy(names + pos, rf->unnames[i], len);
+        pos += len;
+    }
+
+    CacheHeader h;
+    memset(&h, 0, sizeof(CacheHeader));
+    memcpy(h.magic, CACHE_MAGIC, 8);
+    h.version = CACHE_VERSION;
+    h.bom = CACHE_BOM;
+    h.ncands = n;
+    h.nrankers = rf->nrankers;
+    h.nballots = rf->nballots;
+    h.width = mm->width;
+    h.nprefs = rf->nprefs;
+    h.names_off = sizeof(CacheHeader);
+    h.names_len = names_len;
+    h.tri_off = (h.names_off + names_len + CACHELINE - 1) / CACHELINE * CACHELINE;
+    h.tri_len = (uint64_t)n * (n > 0 ? n - 1 : 0) / 2 * mm->width;
+    h.payload_sum = checksum(checksum(CHECKSUM_SEED, names, names_len), mm->tri, h.tri_len);
+    h.header_sum = header_checksum(&h);
+
+    size_t tlen = strlen(path) + 5;
+    char *tmp = malloc(tlen);
+    FILE *f = tmp ? (snprintf(tmp, tlen, "%s.tmp", path), fopen(tmp, "wb")) : NULL;
+    if (!f) {
+        fprintf(stderr, "Cannot write %s\n", path);
+        free(names);
+        free(tmp);
+        return 0;
+    }
+    static const char zeros[CACHELINE];
+    size_t pad = h.tri_off - h.names_off - names_len;
+    int ok = fwrite(&h, sizeof(CacheHeader), 1, f) == 1 &&
+             fwrite(names, 1, names_len, f) == names_len &&
+             fwrite(zeros, 1, pad, f) == pad &&
+             fwrite(mm->tri, 1, h.tri_len, f) == h.tri_len;
+    ok = (fclose(f) == 0) && ok;
+#ifdef _WIN32
+    if (ok) remove(path);   // rename does not replace files here
+#endif
+    ok = ok && rename(tmp, path) == 0;
+    if (!ok) {
+        fprintf(stderr, "Cannot write %s\n", path);
+        remove(tmp);
+    }
+    free(names);
+    free(tmp);
+    return ok;
+}
+
+// Reason the mapped file is not a usable cache, NULL if it is
+static const char *check_cache(const MappedFile *mf) {
+    const CacheHeader *h = (const CacheHeader *)mf->data;
+    if (mf->len < sizeof(CacheHeader) || memcmp(h->magic, CACHE_MAGIC, 8) != 0)
+        return "not an election cache";
+    if (h->version != CACHE_VERSION) return "unsupported cache version";
+    if (h->bom != CACHE_BOM) return "cache written with another byte order";
+    if (h->header_sum != header_checksum(h)) return "damaged cache header";
+
+    uint64_t n = h->ncands > 0 ? (uint64_t)h->ncands : 0;
+    if (h->ncands < 0 || h->nrankers < 0 || (h->width != 2 && h->width != 4) ||
+        h->tri_off % CACHELINE != 0 || h->tri_len != n * (n > 0 ? n - 1 : 0) / 2 * h->width ||
+        h->names_off < sizeof(CacheHeader) || h->names_off > mf->len ||
+        h->names_len > mf->len - h->names_off || h->tri_off < h->names_off + h->names_len ||
+        h->tri_off > mf->len || h->tri_len > mf->len - h->tri_off)
+        return "inconsistent cache layout";
+
+    uint64_t sum = checksum(CHECKSUM_SEED, mf->data + h->names_off, h->names_len);
+    if (checksum(sum, mf->data + h->tri_off, h->tri_len) != h->payload_sum)
+        return "cache checksum mismatch";
+    return NULL;
+}
+
+//----------------------------------------------------------
+// Function: read_cache_file
+//----------------------------------------------------------
+// Maps a cache written by write_cache_file and returns a
+// RanksFile whose margin matrix lives in the mapping (the
+// RanksFile keeps it mapped until it is destroyed). Returns
+// NULL if the file cannot be read, is damaged or was written
+// by an incompatible version. The summary line goes to
+// outfile unless it is NULL.
+//----------------------------------------------------------
+RanksFile *read_cache_file(const char *path, FILE *outfile) {
+    MappedFile *mf = malloc(sizeof(MappedFile));
+    if (!mf || !map_file(path, mf)) {
+        fprintf(stderr, "Cannot read %s\n", path);
+        free(mf);
+        return NULL;
+    }
+    const char *err = check_cache(mf);
+    if (err) {
+        fprintf(stderr, "%s: %s\n", path, err);
+        unmap_file(mf);
+        free(mf);
+        return NULL;
+    }
+
+    const CacheHeader *h = (const CacheHeader *)mf->data;
+    int n = h->ncands;
+    RanksFile *rf = ranksfile_create(n, h->nrankers);
+    MarginMatrix *mm = calloc(1, sizeof(MarginMatrix));
+    if (!rf || !mm) {
+        fprintf(stderr, "Out of memory for %d candidates!\n", n);
+        goto fail;
+    }
+    rf->nballots = h->nballots;
+    rf->nprefs = h->nprefs;
+    rf->cache = mf;
+
+    // Names, in index order
+    const char *name = mf->data + h->names_off, *nend = name + h->names_len;
+    for (int i = 0; i < n; i++) {
+        const char *z = memchr(name, '\0', nend - name);
+        if (!z || nametable_intern(&rf->names, name, z - name) != i) {
+            fprintf(stderr, "%s: bad or duplicate name for candidate %d\n", path, i + 1);
+            goto fail;
+        }
+        name = z + 1;
+    }
+    rf->unnames = rf->names.names;
+
+    // The margins are used in place; prefmat is expanded from them
+    mm->n = n;
+    mm->width = h->width;
+    mm->tri = (void *)(mf->data + h->tri_off);
+    mm->borrowed = 1;
+    rf->margins = mm;
+    mm = NULL;
+    const char *m = rf->margins->tri;
+    for (int a = 0; a < n; a++) {
+        int *row = &PREF(rf, a, 0);
+        for (int b = a + 1; b < n; b++, m += h->width) {
+            int v = (h->width == 2) ? *(const int16_t *)m : *(const int32_t *)m;
+            row[b] = v;
+            PREF(rf, b, a) = -v;
+        }
+    }
+
+    if (outfile && rf->nballots >= 0)
+        fprintf(outfile, "*** There are %d candidates and %d voters (%d unique orders, from cache). ***\n",
+                rf->ncands, rf->nrankers, rf->nballots);
+    else if (outfile)
+        fprintf(outfile, "*** There are %d candidates and %d voters (from cache). ***\n", rf->ncands, rf->nrankers);
+    return rf;
+
+fail:
+    free(mm);
+    if (rf && rf->cache) ranksfile_destroy(rf);   // Unmaps mf as well
+    else {
+        ranksfile_destroy(rf);
+        unmap_file(mf);
+        free(mf);
+    }
+    return NULL;
+}
+
+//----------------------------------------------------------
+// Function: read_election
+//----------------------------------------------------------
+// Picks the loader by file name: cache files and PrefLib
+// files by their extension, anything else (and stdin) as
+// ballot lines.
+//----------------------------------------------------------
+RanksFile *read_election(const char *path, FILE *outfile, int showinput) {
+    if (path && is_cache_path(path)) return read_cache_file(path, outfile);
+    if (path && is_preflib_path(path)) return read_preflib_file(path, outfile);
+    return read_ranks_file(path, outfile, showinput);
+}
@@ -0,0 +1,291 @@
+// components.c
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <pthread.h>
+#include "ranksfile.h"
+#include "bitset.h"
+
+//----------------------------------------------------------
+// Majority-graph decomposition
+//----------------------------------------------------------
+// The majority graph has an edge a -> b whenever m(a,b) >= 0,
+// so a tie gives edges both ways. Every pair has at least
+// one edge, so its strongly connected components form a
+// chain: every candidate of an earlier component beats every
+// candidate of a later one by a strict majority. By the
+// extended Condorcet criterion a Kemeny consensus ranks the
+// components in that order, and only the order inside each
+// component is left to a solver.
+//
+// kemeny_solve runs a solver on each component separately,
+// in parallel, and stitches the rankings back together.
+//----------------------------------------------------------
+
+typedef struct {
+    const Tournament *tour;
+    int n;
+    int *index;           // DFS number, -1 if unvisited
+    int *low;             // Lowest DFS number reachable
+    int *stack;           // Tarjan stack
+    char *onstack;
+    int sp;
+    int counter;
+    int *members;         // Filled from the back, one component at a time
+    int *sizes;           // Component sizes in completion order
+    int filled;
+    int ncomps;
+} Tarjan;
+
+// Tarjan's algorithm on the majority graph, whose edges out
+// of v are the wins and ties of v in the tournament.
+// Components complete sink first, that is worst first.
+static void strongconnect(Tarjan *t, int v) {
+    t->index[v] = t->low[v] = t->counter++;
+    t->stack[t->sp++] = v;
+    t->onstack[v] = 1;
+
+    int nw = t->tour->nwords;
+    const uint64_t *win = &t->tour->wins[(size_t)v * nw];
+    const uint64_t *tie = &t->tour->ties[(size_t)v * nw];
+    for (int q = 0; q < nw; q++) {
+        for (uint64_t bits = win[q] | tie[q]; bits; bits &= bits - 1) {
+            int w = q * 64 + __builtin_ctzll(bits);
+            if (t->index[w] < 0) {
+                strongconnect(t, w);
+                if (t->low[w] < t->low[v]) t->low[v] = t->low[w];
+            } else if (t->onstack[w] && t->index[w] < t->low[v]) {
+                t->low[v] = t->index[w];
+            }
+        }
+    }
+
+    if (t->low[v] == t->index[v]) {
+        int size = 0, w;
+        do {
+            w = t->stack[--t->sp];
+            t->onstack[w] = 0;
+            t->members[t->n - ++t->filled] = w;
+            size++;
+        } while (w != v);
+        t->sizes[t->ncomps++] = size;
+    }
+}
+
+//----------------------------------------------------------
+// Function: components_create
+//----------------------------------------------------------
+// Splits the candidates of the tournament into the strongly
+// connected components of its majority graph, best component
+// first. Returns NULL if memory cannot be allocated.
+//----------------------------------------------------------
+Components *components_create(const Tournament *tour) {
+    int n = tour->n;
+    int sz = n > 0 ? n : 1;
+    Components *cc = calloc(1, sizeof(Components));
+    Tarjan t;
+    memset(&t, 0, sizeof(Tarjan));
+    t.tour = tour;
+    t.n = n;
+    t.index = malloc(sz * sizeof(int));
+    t.low = malloc(sz * sizeof(int));
+    t.stack = malloc(sz * sizeof(int));
+    t.onstack = calloc(sz, 1);
+    t.sizes = malloc(sz * sizeof(int));
+    if (cc) {
+        cc->members = malloc(sz * sizeof(int));
+        cc->start = malloc((sz + 1) * sizeof(int));
+    }
+    t.members = cc ? cc->members : NULL;
+
+    if (!cc || !cc->members || !cc->start || !t.index || !t.low || !t.stack || !t.onstack || !t.sizes) {
+        components_destroy(cc);
+        cc = NULL;
+        goto done;
+    }
+
+    for (int v = 0; v < n; v++) t.index[v] = -1;
+    for (int v = 0; v < n; v++)
+        if (t.index[v] < 0) strongconnect(&t, v);
+
+    // Sizes were recorded worst first
+    cc->ncomps = t.ncomps;
+    cc->start[0] = 0;
+    for (int k = 0; k < t.ncomps; k++) {
+        int size = t.sizes[t.ncomps - 1 - k];
+        cc->start[k + 1] = cc->start[k] + size;
+        if (size > cc->largest) cc->largest = size;
+    }
+
+done:
+    free(t.index);
+    free(t.low);
+    free(t.stack);
+    free(t.onstack);
+    free(t.sizes);
+    return cc;
+}
+
+void components_destroy(Components *cc) {
+    if (!cc) return;
+    free(cc->members);
+    free(cc->start);
+    free(cc);
+}
+
+//----------------------------------------------------------
+// Function: ranksfile_subset
+//----------------------------------------------------------
+// A new RanksFile restricted to the k candidates cands[],
+// candidate i of the result being cands[i] of rf, with the
+// same names, voter count and options. NULL if out of memory.
+//----------------------------------------------------------
+RanksFile *ranksfile_subset(const RanksFile *rf, const int *cands, int k) {
+    RanksFile *sub = ranksfile_create(k, rf->nrankers);
+    if (!sub) return NULL;
+    sub->nballots = rf->nballots;
+    sub->opts = rf->opts;
+
+    for (int i = 0; i < k; i++) {
+        const char *name = rf->unnames[cands[i]];
+        if (nametable_intern(&sub->names, name, strlen(name)) != i) {
+            ranksfile_destroy(sub);
+            return NULL;
+        }
+        for (int j = 0; j < k; j++) {
+            int m = PREF(rf, cands[i], cands[j]);
+            PREF(sub, i, j) = m;
+            if (m > 0) sub->nprefs += m;
+        }
+    }
+    sub->unnames = sub->names.names;
+    return sub;
+}
+
+//----------------------------------------------------------
+// Parallel solve of the components
+//----------------------------------------------------------
+
+typedef struct {
+    const int *cands;     // Members of the component
+    int k;                // Their number
+    int *perm;            // Where its ranking goes in the full ranking
+    long long score;
+    long long nodes;
+} ComponentTask;
+
+typedef struct {
+    RanksFile *rf;
+    KemenySolver solve;
+    ComponentTask *tasks; // Largest component first
+    int ntasks;
+    int next;             // Next task to hand out
+    int nthreads;         // Threads each component solver may use
+    pthread_mutex_t lock;
+} ComponentPool;
+
+static void *component_worker(void *arg) {
+    ComponentPool *pool = *(ComponentPool **)arg;
+    for (;;) {
+        pthread_mutex_lock(&pool->lock);
+        int i = pool->next++;
+        pthread_mutex_unlock(&pool->lock);
+        if (i >= pool->ntasks) break;
+
+        ComponentTask *t = &pool->tasks[i];
+        RanksFile *sub = ranksfile_subset(pool->rf, t->cands, t->k);
+        if (!sub) {
+            t->score = KEMENY_NO_SCORE;
+            continue;
+        }
+        sub->opts.nthreads = pool->nthreads;
+        int *local = malloc(t->k * sizeof(int));
+        t->score = local ? pool->solve(sub, local) : KEMENY_NO_SCORE;
+        if (t->score != KEMENY_NO_SCORE) {
+            for (int j = 0; j < t->k; j++) t->perm[j] = t->cands[local[j]];
+        }
+        t->nodes = sub->stats.nodes;
+        if (sub->stats.gap > 0) {
+            pthread_mutex_lock(&pool->lock);
+            pool->rf->stats.gap += sub->stats.gap;
+            pthread_mutex_unlock(&pool->lock);
+        }
+        free(local);
+        ranksfile_destroy(sub);
+    }
+    return NULL;
+}
+
+static int by_size_desc(const void *a, const void *b) {
+    const ComponentTask *x = a, *y = b;
+    return y->k - x->k;
+}
+
+//----------------------------------------------------------
+// Function: kemeny_solve
+//----------------------------------------------------------
+// Runs solve on rf, or on each majority-graph component of
+// rf when opts.decompose is set, and returns the score of
+// the combined ranking (KEMENY_NO_SCORE if any component
+// could not be solved). Components with one candidate need
+// no solver. When several components need one they run in
+// parallel, each solver single-threaded; a lone component
+// keeps all threads.
+//----------------------------------------------------------
+long long kemeny_solve(RanksFile *rf, KemenySolver solve, int *perm) {
+    memset(&rf->stats, 0, sizeof(SolveStats));
+
+    const Components *cc = rf->opts.decompose ? ranksfile_components(rf) : NULL;
+    if (!cc || cc->ncomps <= 1) return solve(rf, perm);
+
+    ComponentPool pool;
+    memset(&pool, 0, sizeof(ComponentPool));
+    pool.rf = rf;
+    pool.solve = solve;
+    pool.tasks = malloc(cc->ncomps * sizeof(ComponentTask));
+    if (!pool.tasks) return KEMENY_NO_SCORE;
+
+    for (int k = 0; k < cc->ncomps; k++) {
+        int lo = cc->start[k], size = cc->start[k + 1] - lo;
+        if (size == 1) {
+            perm[lo] = cc->members[lo];
+            continue;
+        }
+        pool.tasks[pool.ntasks++] = (ComponentTask){ &cc->members[lo], size, &perm[lo], 0, 0 };
+    }
+    qsort(pool.tasks, pool.ntasks, sizeof(ComponentTask), by_size_desc);
+
+    int nthreads = ranksfile_threads(rf);
+    int nworkers = nthreads < pool.ntasks ? nthreads : pool.ntasks;
+    pool.nthreads = (pool.ntasks == 1) ? rf->opts.nthreads : 1;
+    pthread_mutex_init(&pool.lock, NULL);
+    ComponentPool **args = malloc((nworkers > 0 ? nworkers : 1) * sizeof(ComponentPool *));
+    if (args) {
+        for (int t = 0; t < nworkers; t++) args[t] = &pool;
+        run_parallel(component_worker, args, sizeof(ComponentPool *), nworkers);
+    }
+    free(args);
+    pthread_mutex_destroy(&pool.lock);
+
+    long long score = args ? 0 : KEMENY_NO_SCORE;
+    for (int i = 0; i < pool.ntasks; i++) {
+        if (pool.tasks[i].score == KEMENY_NO_SCORE) score = KEMENY_NO_SCORE;
+        rf->stats.nodes += pool.tasks[i].nodes;
+    }
+    free(pool.tasks);
+    if (score == KEMENY_NO_SCORE) return score;
+
+    // Score of the stitched ranking
+    return ranking_score(rf, perm);
+}
+
+//----------------------------------------------------------
+// Function: kemeny_solve_size
+//----------------------------------------------------------
+// The largest number of candidates kemeny_solve hands to a
+// solver at once, for the size limits of the exact solvers.
+//----------------------------------------------------------
+int kemeny_solve_size(RanksFile *rf) {
+    const Components *cc = rf->opts.decompose ? ranksfile_components(rf) : NULL;
+    return cc ? cc->largest : rf->ncands;
+}
@@ -4,68 +4,63 @@
 #include "ranksfile.h"
 
 //----------------------------------------------------------
-// Structure to hold scores for sorting
+// Function: copeland_solve
 //----------------------------------------------------------
-typedef struct {
-    int index;
-    float score;
-} CandidateScore;
-
-//----------------------------------------------------------
-// Comparison function for qsort (descending order)
+// Fills perm with the Copeland ranking and returns its
+// Kemeny score, or KEMENY_NO_SCORE if out of memory.
 //----------------------------------------------------------
-int compare_candidates(const void *a, const void *b) {
-    const CandidateScore *score_a = (const CandidateScore *)a;
-    const CandidateScore *score_b = (const CandidateScore *)b;
+long long copeland_solve(RanksFile *rf, int *perm) {
+    int n = rf->ncands;
+    const Tournament *t = ranksfile_tournament(rf);
+    KeyedCand *candidates = malloc((n > 0 ? n : 1) * sizeof(KeyedCand));
+    if (!t || !candidates) {
+        free(candidates);
+        return KEMENY_NO_SCORE;
+    }
+    for (int i = 0; i < n; i++) candidates[i] = (KeyedCand){ t->copeland2[i], i };   // Twice the score
+    sort_keyed_desc(candidates, n);
 
-    // Sort in descending order
-    if (score_a->score > score_b->score) return -1;
-    if (score_a->score < score_b->score) return 1;
-    return 0;
+    for (int i = 0; i < n; i++) perm[i] = candidates[i].cand;
+    free(candidates);
+    return ranking_score(rf, perm);
 }
 
 //----------------------------------------------------------
 // Function: compute_copeland_approximation
 //----------------------------------------------------------
+// The scores (a win is 1, a tie 0.5, a loss 0) come from
+// the majority tournament, which counts the win and tie bits
+// of each candidate.
+//----------------------------------------------------------
 void compute_copeland_approximation(RanksFile *rf, FILE *outfile) {
     fprintf(outfile, "\n=== COPELAND APPROXIMATION ===\n");
 
     int n = rf->ncands;
-    CandidateScore candidates[MAXCANDS];
-
-    // Initialize scores
-    for (int i = 0; i < n; i++) {
-        candidates[i].index = i;
-        candidates[i].score = 0.0;
+    const Tournament *t = ranksfile_tournament(rf);
+    KeyedCand *candidates = malloc((n > 0 ? n : 1) * sizeof(KeyedCand));
+    if (!t || !candidates) {
+        fprintf(outfile, "Copeland: out of memory.\n");
+        free(candidates);
+        return;
     }
 
-    // Build win/loss/tie matrix and calculate scores
-    for (int i = 0; i < n; i++) {
-        for (int j = 0; j < n; j++) {
-            if (i != j) {
-                if (rf->prefmat[i][j] > 0) {
-                    candidates[i].score += 1.0;  // win
-                } else if (rf->prefmat[i][j] == 0) {
-                    candidates[i].score += 0.5;  // tie
-                }
-                // loss adds 0.0
-            }
-        }
-    }
+    for (int i = 0; i < n; i++) candidates[i] = (KeyedCand){ t->copeland2[i], i };   // Twice the score
 
     // Print Copeland scores
     fprintf(outfile, "Copeland scores (wins + 0.5*ties):\n");
     for (int i = 0; i < n; i++) {
-        fprintf(outfile, "%s: %.1f\n", rf->unnames[i], candidates[i].score);
+        fprintf(outfile, "%s: %.1f\n", rf->unnames[i], candidates[i].key / 2.0);
     }
 
     // Use qsort for fast sorting (O(n log n))
-    qsort(candidates, n, sizeof(CandidateScore), compare_candidates);
+    sort_keyed_desc(candidates, n);
 
     // Print final ranking
     fprintf(outfile, "\nFinal Copeland Ranking:\n");
     for (int i = 0; i < n; i++) {
         fprintf(outfile, "%d. %s (score: %.1f)\n", i + 1,
-                rf->unnames[candidates[i].index], candidates[i].score);
+                rf->unnames[candidates[i].cand], candidates[i].key / 2.0);
     }
+
+    free(candidates);
 }
@@ -4,134 +4,205 @@
 #include <math.h>
 #include "ranksfile.h"
 
-//----------------------------------------------------------
-// Helper function: get_candidate_index
-//----------------------------------------------------------
-// Given a candidate's name (string), find its index in rf->unnames.
-// If not found, returns -1.
-//----------------------------------------------------------
-int get_candidate_index(char *name, RanksFile *rf) {
-    for (int i = 0; i < rf->ncands; i++) {
-        if (strcmp(name, rf->unnames[i]) == 0) {   // Compare with each stored candidate name
-            return i;  // Found → return its index
-        }
-    }
-    return -1; // Not found
-}
-
-//----------------------------------------------------------
-// Function: read_ranks_file
-//----------------------------------------------------------
-// Reads voter rankings from an input file.
-// Populates the RanksFile struct with candidate names and
-// updates the pairwise preference matrix.
-//
-// Parameters:
-// - infile: input stream (e.g., stdin or file)
-// - rf: pointer to RanksFile struct to fill
-// - outfile: output stream (for printing info)
-// - showinput: if nonzero, prints each input line read
-//----------------------------------------------------------
-void read_ranks_file(FILE *infile, RanksFile *rf, FILE *outfile, int showinput) {
-    // Initialize counts
-    rf->nrankers = 0;
-    rf->ncands = 0;
-    rf->nprefs = 0;
-
-    // Read input lines until EOF or max voters reached
-    while (fgets(rf->thedata[rf->nrankers], BUFFLEN, infile) != NULL) {
-        if (rf->nrankers >= MAXVOTERS) break;   // Stop if too many voters
-
-        // Optionally print the line read
-        if (showinput)
-            fprintf(outfile, "%s", rf->thedata[rf->nrankers]);
-
-        // Prepare to parse tokens (candidate names)
-        char *tokens[MAXCANDS];
-        int onevote[MAXCANDS];
-        int nvotes = 0;   // Number of candidates ranked in this line
-
-        char *line = rf->thedata[rf->nrankers];
-        char *token = strtok(line, " \t\r\n");   // Split by space/tab/newline
-
-        // Process each token (candidate name)
-        while (token != NULL) {
-            int idx = get_candidate_index(token, rf); // Get candidate index if known
-
-            if (idx == -1) { // New candidate (not seen before)
-                idx = rf->ncands;
-                if (idx >= MAXCANDS) { // Safety check
-                    fprintf(stderr, "Exceeded maximum candidates!\n");
-                    exit(1);
-                }
-                strcpy(rf->unnames[idx], token); // Store candidate name
-                rf->ncands++;                    // Increase candidate count
-            }
-
-            onevote[nvotes++] = idx;  // Store candidate index for this ranking
-            token = strtok(NULL, " \t\r\n"); // Move to next token
-        }
-
-        //--------------------------------------------------
-        // Update preference matrix based on ranking
-        //--------------------------------------------------
-        // For each pair (i,j) where i is ranked before j,
-        // increment prefmat[i][j] (i preferred to j)
-        // and decrement prefmat[j][i].
-        //--------------------------------------------------
-        for (int i = 0; i < nvotes - 1; i++) {
-            for (int j = i + 1; j < nvotes; j++) {
-                rf->prefmat[onevote[i]][onevote[j]] += 1;  // i preferred over j
-                rf->prefmat[onevote[j]][onevote[i]] -= 1;  // j less preferred than i
-                rf->nprefs++;                               // Count total pairwise prefs
-            }
-        }
-
-        rf->nrankers++; // One voter processed
-        if (rf->nrankers >= MAXVOTERS) break; // Safety check
-    }
-
-    // Print summary
-    fprintf(outfile, "*** There are %d candidates and %d voters. ***\n", rf->ncands, rf->nrankers);
-}
-
-
 //----------------------------------------------------------
 // main function
 //----------------------------------------------------------
 // Entry point. Reads input, builds preference matrix,
 // and prints it for verification.
+//
+// Usage: kemeny [--threads N] [--node-limit N] [--no-decompose]
+//               [--first-improvement] [--window N] [--restarts N]
+//               [--seed N] [--time-limit-ms N] [--kwiksort-reps N]
+//               [--methods LIST] [--print-matrix] [--save-cache FILE]
+//               [--emit-partial FILE]
+//               [--stream] [--listen PATH] [--refresh-every N]
+//               [ballot file]
+//        kemeny merge [options] PARTIAL...
+//        kemeny batch [options] [--output FILE] DIR|MANIFEST...
+// Ballots are read from stdin unless a file is given.
+// PrefLib files (.soc, .soi, .toc, .toi) and election
+// caches (.kmc) are recognised by their extension.
+// --save-cache writes the election read, whatever its
+// format, to a cache file, which later runs load without
+// parsing any ballots (see cache.c). --threads sets the
+// number of worker threads (0 = one per CPU), --node-limit
+// the branch-and-bound budget (0 = unlimited). The exact and
+// local-search solvers run on each component of the majority
+// graph separately unless --no-decompose is given.
+// --first-improvement makes the local search take the first
+// improving move instead of the best one, and --window sets
+// the length of the windows it reorders exactly (default 12).
+// The multi-start search runs --restarts descents (default
+// 16) seeded by --seed, starting none after --time-limit-ms.
+// The same budget bounds the anytime (annealing) solver,
+// which prints each better ranking as soon as it finds one.
+// KwikSort keeps the best of --kwiksort-reps runs (default 8).
+// --methods runs the comma-separated methods named instead
+// of the default preset (brute force, heuristic, Borda,
+// Copeland and ranked pairs); "all" runs every method in
+// methods.c. --print-matrix dumps the preference matrix at
+// the end.
+//
+// --stream keeps running instead (see stream.c): the ballot
+// file, if any, is the starting election, and further
+// ballots and !consensus requests are read from stdin, or
+// from the clients of the Unix socket --listen PATH. With
+// --refresh-every N the consensus is also printed after
+// every N ballots.
+//
+// --emit-partial writes the same file as --save-cache and
+// stops there: it is the partial aggregate of one shard of
+// the ballots. "kemeny merge" reads any number of partials
+// (or other elections) as one election, the sum of their
+// matrices with candidates matched by name, and then runs
+// like a single file: --emit-partial passes the merged
+// aggregate on (see merge.c).
+//
+// "kemeny batch" runs the methods on every PrefLib file
+// under the given directories and every file listed in the
+// given manifests, spread over the --threads workers, and
+// writes one JSON line per election to stdout or --output
+// (see batch.c).
 //----------------------------------------------------------
 int main(int argc, char **argv) {
-    FILE *INP = stdin;   // Default input from standard input
     FILE *OUTP = stdout; // Default output to standard output
 
     int showinput = 0;   // Whether to print input lines (disabled by default)
+    int printmatrix = 0; // Whether to dump the preference matrix
+    const char *path = NULL;
+    const char *cachepath = NULL;   // Where to save the election read
+    const char *methods = "default";
+    int stream = 0;             // Keep reading ballots after the file
+    const char *listenpath = NULL;
+    int refresh_every = 0;
+    const char *partialpath = NULL; // Write the aggregate there and stop
+    int batch = argc > 1 && strcmp(argv[1], "batch") == 0;
+    int merge = argc > 1 && strcmp(argv[1], "merge") == 0;
+    const char **inputs = malloc(argc * sizeof(char *));   // Batch or merge inputs
+    int ninputs = 0;
+    const char *outpath = NULL;
+    const KemenyMethod *sel[64];
+    RanksFile *rf;
+
+    // Parse command line options
+    for (int i = 1 + batch + merge; i < argc; i++) {
+        if (strcmp(argv[i], "--threads") == 0 && i + 1 < argc) {
+            kemeny_default_options.nthreads = atoi(argv[++i]);
+        } else if (strcmp(argv[i], "--node-limit") == 0 && i + 1 < argc) {
+            kemeny_default_options.node_limit = atoll(argv[++i]);
+        } else if (strcmp(argv[i], "--no-decompose") == 0) {
+            kemeny_default_options.decompose = 0;
+        } else if (strcmp(argv[i], "--first-improvement") == 0) {
+            kemeny_default_options.first_improvement = 1;
+        } else if (strcmp(argv[i], "--window") == 0 && i + 1 < argc) {
+            kemeny_default_options.window = atoi(argv[++i]);
+        } else if (strcmp(argv[i], "--restarts") == 0 && i + 1 < argc) {
+            kemeny_default_options.restarts = atoi(argv[++i]);
+        } else if (strcmp(argv[i], "--seed") == 0 && i + 1 < argc) {
+            kemeny_default_options.seed = strtoull(argv[++i], NULL, 10);
+        } else if (strcmp(argv[i], "--time-limit-ms") == 0 && i + 1 < argc) {
+            kemeny_default_options.time_limit_ms = atoll(argv[++i]);
+        } else if (strcmp(argv[i], "--kwiksort-reps") == 0 && i + 1 < argc) {
+            kemeny_default_options.kwiksort_reps = atoi(argv[++i]);
+        } else if (strcmp(argv[i], "--methods") == 0 && i + 1 < argc) {
+            methods = argv[++i];
+        } else if (strcmp(argv[i], "--print-matrix") == 0) {
+            printmatrix = 1;
+        } else if (strcmp(argv[i], "--save-cache") == 0 && i + 1 < argc) {
+            cachepath = argv[++i];
+        } else if (strcmp(argv[i], "--emit-partial") == 0 && i + 1 < argc) {
+            partialpath = argv[++i];
+        } else if (strcmp(argv[i], "--stream") == 0) {
+            stream = 1;
+        } else if (strcmp(argv[i], "--listen") == 0 && i + 1 < argc) {
+            listenpath = argv[++i];
+            stream = 1;
+        } else if (strcmp(argv[i], "--refresh-every") == 0 && i + 1 < argc) {
+            refresh_every = atoi(argv[++i]);
+        } else if (batch && strcmp(argv[i], "--output") == 0 && i + 1 < argc) {
+            outpath = argv[++i];
+        } else if (argv[i][0] == '-' && argv[i][1] != '\0') {
+            fprintf(stderr, "Usage: %s [--threads N] [--node-limit N] [--no-decompose] [--first-improvement]\n"
+                    "       [--window N] [--restarts N] [--seed N] [--time-limit-ms N]\n"
+                    "       [--kwiksort-reps N] [--methods LIST] [--print-matrix] [--save-cache FILE]\n"
+                    "       [--emit-partial FILE] [--stream] [--listen PATH] [--refresh-every N] [ballot file]\n"
+                    "       %s merge [options] PARTIAL...\n"
+                    "       %s batch [options] [--output FILE] DIR|MANIFEST...\n", argv[0], argv[0], argv[0]);
+            return 1;
+        } else if ((batch || merge) && inputs) {
+            inputs[ninputs++] = argv[i];
+        } else {
+            path = argv[i];
+        }
+    }
 
-    RanksFile rf;                // Create a RanksFile object
-    memset(&rf, 0, sizeof(RanksFile)); // Initialize it to zero
+    // Check the method names before reading any input
+    int nsel = kemeny_select_methods(methods, sel, 64);
+    if (nsel < 0) return 1;
 
-    // Read and process all input data
-    read_ranks_file(INP, &rf, OUTP, showinput);
+    if (batch) {
+        FILE *out = outpath ? fopen(outpath, "w") : OUTP;
+        if (!out) {
+            fprintf(stderr, "Cannot write %s\n", outpath);
+            return 1;
+        }
+        int failed = ninputs > 0 ? kemeny_batch(inputs, ninputs, sel, nsel, out) : -1;
+        if (ninputs == 0) fprintf(stderr, "batch: no directory or manifest given\n");
+        if (out != OUTP) fclose(out);
+        free(inputs);
+        return failed != 0;
+    }
 
-    // Run all ranking methods
-    compute_kemeny_bruteforce(&rf, stdout);  // Bruteforce approach
-    compute_heuristic_kemeny(&rf, stdout);   // Local search heuristic
-    compute_borda_heuristic(&rf, stdout);    // Borda count heuristic
-    compute_copeland_approximation(&rf, stdout); // Copeland approximation
-    compute_ranked_pairs(&rf, stdout);   // Ranked Pairs/Tiedmann approach 
-    // compute_quicksort_approximation(&rf, stdout);
+    // Read and process all input data into a RanksFile sized to fit
+    if (merge) {
+        if (ninputs == 0) fprintf(stderr, "merge: no partial aggregate given\n");
+        rf = ninputs > 0 ? read_merged(inputs, ninputs, OUTP) : NULL;
+    } else if (stream && !path) {
+        rf = ranksfile_create(0, 0);   // Start from an empty election
+    } else {
+        rf = read_election(path, OUTP, showinput);
+    }
+    free(inputs);
+    if (!rf) return 1;
+    if (cachepath && !write_cache_file(rf, cachepath)) {
+        ranksfile_destroy(rf);
+        return 1;
+    }
+    if (partialpath) {
+        int ok = write_cache_file(rf, partialpath);
+        ranksfile_destroy(rf);
+        return !ok;
+    }
+
+    // Streaming: stdin (or the socket) carries the ballots to add
+    if (stream) {
+        KemenyStream ks;
+        stream_init(&ks, rf);
+        ks.refresh_every = refresh_every;
+        int status = 0;
+        if (listenpath) status = stream_listen(&ks, listenpath, stderr);
+        else status = stream_serve(&ks, stdin, OUTP);
+        stream_free(&ks);
+        ranksfile_destroy(rf);
+        return status < 0 ? 1 : 0;
+    }
+
+    // Run the selected ranking methods
+    kemeny_run_methods(rf, sel, nsel, OUTP);
 
     //--------------------------------------------------
     // Print the preference matrix for verification
     //--------------------------------------------------
-    fprintf(OUTP, "\nPreference matrix:\n");
-    for (int i = 0; i < rf.ncands; i++) {
-        for (int j = 0; j < rf.ncands; j++) {
-            fprintf(OUTP, "%4d ", rf.prefmat[i][j]); // Print each matrix entry
+    if (printmatrix) {
+        fprintf(OUTP, "\nPreference matrix:\n");
+        for (int i = 0; i < rf->ncands; i++) {
+            for (int j = 0; j < rf->ncands; j++) {
+                fprintf(OUTP, "%4d ", PREF(rf, i, j)); // Print each matrix entry
+            }
+            fprintf(OUTP, "\n");
         }
-        fprintf(OUTP, "\n");
     }
 
+    ranksfile_destroy(rf);
     return 0; // Program completed successfully
 }
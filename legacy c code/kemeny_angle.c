@@ -24,7 +24,7 @@ void phi_dataset(RanksFile *rf, double *phi) {
     int idx = 0;
     for (int i = 0; i < n; i++)
         for (int j = i + 1; j < n; j++, idx++)
-            phi[idx] = rf->prefmat[i][j] - rf->prefmat[j][i];
+            phi[idx] = PREF(rf, i, j);   // Margin of i over j
 }
 
 // ---------- Cosine similarity ----------
@@ -38,80 +38,121 @@ double cosine_similarity(double *a, double *b, int len) {
     return dot / (sqrt(na) * sqrt(nb));
 }
 
+// ---------- Scan one ballot ----------
+// Reads the next line of whitespace-separated candidate ids
+// (1-based) from the mapped input at *p into rank[] (0-based)
+// if rank is not NULL, and raises *maxid to the largest id if
+// maxid is not NULL. Returns the number of ids on the line,
+// or -1 at the end of the input.
+static int scan_ballot(const char **p, const char *end, int *rank, int maxlen, int *maxid) {
+    const char *tok;
+    size_t tlen;
+    int r, len = 0;
+    if (*p >= end) return -1;
+    while ((r = next_token(p, end, &tok, &tlen)) == 1) {
+        int val = 0;
+        for (size_t i = 0; i < tlen; i++) val = val * 10 + (tok[i] - '0');
+        if (rank && len < maxlen) rank[len] = val - 1; // 0-based
+        if (maxid && val > *maxid) *maxid = val;
+        len++;
+    }
+    return len;
+}
+
 // ---------- Read votes.txt ----------
-int read_votes(const char *filename, RanksFile *rf) {
-    FILE *f = fopen(filename, "r");
-    if (!f) return 0;
-
-    rf->nrankers = 0;
-    rf->ncands = 0;
-    char line[BUFFLEN];
-
-    while (fgets(line, sizeof(line), f)) {
-        if (rf->nrankers >= MAXVOTERS) break;
-        strcpy(rf->thedata[rf->nrankers], line);
-
-        int pos = 0;
-        char temp[BUFFLEN];
-        strcpy(temp, line);
-        char *token = strtok(temp, " \t\n");
-        while (token) {
-            int val = atoi(token) - 1; // 0-based
-            if (val+1 > rf->ncands) rf->ncands = val+1;
-            token = strtok(NULL, " \t\n");
-            pos++;
-        }
-        rf->nrankers++;
+// The file is memory-mapped and scanned in place twice: the
+// first pass finds the number of voters and candidates so the
+// RanksFile can be sized exactly, the second builds the
+// pairwise margins, as the other loaders do.
+RanksFile *read_votes(const char *filename) {
+    MappedFile in;
+    if (!map_file(filename, &in)) return NULL;
+    const char *end = in.data + in.len, *p;
+
+    int nrankers = 0, ncands = 0, maxlen = 0, len;
+    int *rank = NULL;
+
+    // Pass 1: count voters, longest ballot and largest id
+    p = in.data;
+    while ((len = scan_ballot(&p, end, NULL, 0, &ncands)) >= 0) {
+        nrankers++;
+        if (len > maxlen) maxlen = len;
     }
-    fclose(f);
-
-    // Build pairwise preference matrix
-    memset(rf->prefmat, 0, sizeof(rf->prefmat));
-    for (int v = 0; v < rf->nrankers; v++) {
-        int rank[MAXCANDS];
-        int pos = 0;
-        char temp[BUFFLEN];
-        strcpy(temp, rf->thedata[v]);
-        char *token = strtok(temp, " \t\n");
-        while (token && pos < rf->ncands) {
-            rank[pos++] = atoi(token) - 1;
-            token = strtok(NULL, " \t\n");
-        }
-        for (int i = 0; i < rf->ncands; i++)
-            for (int j = i + 1; j < rf->ncands; j++)
-                rf->prefmat[rank[i]][rank[j]]++;
+    rank = malloc((maxlen > 0 ? maxlen : 1) * sizeof(int));
+
+    RanksFile *rf = ranksfile_create(ncands, nrankers);
+    if (!rf || !rank) {
+        ranksfile_destroy(rf);
+        free(rank);
+        unmap_file(&in);
+        return NULL;
+    }
+    for (int i = 0; i < ncands; i++) {
+        char name[16];
+        int nlen = snprintf(name, sizeof(name), "%d", i + 1);
+        nametable_intern(&rf->names, name, nlen);
+    }
+    rf->unnames = rf->names.names;
+    rf->nballots = nrankers;
+
+    // Pass 2: build pairwise preference matrix
+    p = in.data;
+    while ((len = scan_ballot(&p, end, rank, maxlen, NULL)) >= 0) {
+        for (int i = 0; i < len; i++)
+            for (int j = i + 1; j < len; j++)
+                if (rank[i] >= 0 && rank[j] >= 0) {
+                    PREF(rf, rank[i], rank[j])++;
+                    PREF(rf, rank[j], rank[i])--;
+                    rf->nprefs++;
+                }
     }
 
-    return 1;
+    free(rank);
+    unmap_file(&in);
+    return rf;
 }
 
 // ---------- Main ----------
-int main() {
-    RanksFile rf;
-    memset(&rf, 0, sizeof(RanksFile));
+// Usage: kemeny_angle [--save-cache FILE] [votes file]
+// The votes file defaults to votes.txt; an election cache
+// (.kmc, see cache.c) can be given instead, and
+// --save-cache writes the votes read to one.
+int main(int argc, char **argv) {
+    const char *path = "votes.txt";
+    const char *cachepath = NULL;
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "--save-cache") == 0 && i + 1 < argc) cachepath = argv[++i];
+        else path = argv[i];
+    }
 
-    if (!read_votes("votes.txt", &rf)) {
-        fprintf(stderr, "Failed to read votes.txt\n");
+    RanksFile *rf = is_cache_path(path) ? read_cache_file(path, NULL) : read_votes(path);
+    if (!rf) {
+        fprintf(stderr, "Failed to read %s\n", path);
+        return 1;
+    }
+    if (cachepath && !write_cache_file(rf, cachepath)) {
+        ranksfile_destroy(rf);
         return 1;
     }
 
-    printf("Loaded %d voters, %d candidates.\n", rf.nrankers, rf.ncands);
+    printf("Loaded %d voters, %d candidates.\n", rf->nrankers, rf->ncands);
 
     // Get user guess
-    int guess[MAXCANDS];
-    printf("Enter your guessed ranking (space-separated, 1..%d): ", rf.ncands);
-    for (int i = 0; i < rf.ncands; i++)
+    int *guess = malloc(rf->ncands * sizeof(int));
+    printf("Enter your guessed ranking (space-separated, 1..%d): ", rf->ncands);
+    for (int i = 0; i < rf->ncands; i++)
         scanf("%d", &guess[i]);
 
     // Convert to 0-based internally
-    for (int i = 0; i < rf.ncands; i++) guess[i]--;
+    for (int i = 0; i < rf->ncands; i++) guess[i]--;
 
-    int n = rf.ncands;
+    int n = rf->ncands;
     int npairs = n * (n - 1) / 2;
-    double phi_guess[npairs], phi_data[npairs];
+    double *phi_guess = malloc((npairs > 0 ? npairs : 1) * sizeof(double));
+    double *phi_data = malloc((npairs > 0 ? npairs : 1) * sizeof(double));
 
     phi_sigma(guess, n, phi_guess);
-    phi_dataset(&rf, phi_data);
+    phi_dataset(rf, phi_data);
 
     double cos_theta = cosine_similarity(phi_guess, phi_data, npairs);
     printf("cos(theta_N(sigma)) = %.4f\n", cos_theta);
@@ -132,5 +173,9 @@ int main() {
     else
         printf("⇒ Theorem: Condition not satisfied, guess may be far from consensus\n");
 
+    free(phi_guess);
+    free(phi_data);
+    free(guess);
+    ranksfile_destroy(rf);
     return 0;
 }
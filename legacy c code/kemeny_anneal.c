@@ -0,0 +1,171 @@
+// kemeny_anneal.c
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include "ranksfile.h"
+
+//-----------------------------------------------------
+// Anytime Kemeny consensus by simulated annealing
+//-----------------------------------------------------
+// A move takes a random candidate and reinserts it at a
+// random position. Like move_insert, it flips the pairs the
+// candidate jumps over, so its delta is twice the sum of the
+// candidate's prefmat row over them (one contiguous row, read
+// in ranking order). Improving moves are always taken, worse
+// ones with probability exp(delta / T).
+//
+// The temperature falls geometrically from T0 = 2 * mean|m|
+// to T0 / 200 as the budget is used up. The budget is
+// opts.time_limit_ms of wall-clock time, checked every
+// ANNEAL_CHECK moves; without a time limit it is exactly
+// ANNEAL_MOVES_PER_CAND moves per candidate.
+//
+// The run starts from the mean-preference (Borda) order and
+// keeps the best ranking seen, so it can be stopped at any
+// time with an answer. When a trace file is given, each new
+// incumbent is written to it with its score and the time
+// since the start, at the next clock check after it is
+// found.
+//-----------------------------------------------------
+
+#define ANNEAL_CHECK 1024              // Moves between clock checks
+#define ANNEAL_MOVES_PER_CAND 2000     // Move budget per candidate without a time limit
+
+static void emit(const RanksFile *rf, FILE *trace, double ms, long long score, const int *perm) {
+    fprintf(trace, "  %10.1f ms  score %lld: ", ms, score);
+    for (int i = 0; i < rf->ncands; i++) fprintf(trace, "%s ", rf->unnames[perm[i]]);
+    fprintf(trace, "\n");
+    fflush(trace);
+}
+
+// Runs the annealing; returns the best score and leaves the number of moves in rf->stats
+static long long anneal_run(RanksFile *rf, int *best, FILE *trace) {
+    int n = rf->ncands;
+    double start = monotonic_ms();
+    double limit = (double)rf->opts.time_limit_ms;
+    long long maxmoves = (long long)ANNEAL_MOVES_PER_CAND * n;
+
+    int *perm = malloc((n > 0 ? n : 1) * sizeof(int));
+    KeyedCand *kc = malloc((n > 0 ? n : 1) * sizeof(KeyedCand));
+    if (!perm || !kc) {
+        free(perm);
+        free(kc);
+        return KEMENY_NO_SCORE;
+    }
+
+    // Start: Borda order (sum of margins), the same as init_ranking
+    long long absum = 0;
+    for (int i = 0; i < n; i++) {
+        long long s = 0;
+        for (int j = 0; j < n; j++) {
+            s += PREF(rf, i, j);
+            absum += llabs((long long)PREF(rf, i, j));
+        }
+        kc[i] = (KeyedCand){ s, i };
+    }
+    sort_keyed_desc(kc, n);
+    for (int i = 0; i < n; i++) perm[i] = best[i] = kc[i].cand;
+    free(kc);
+
+    long long score = ranking_score(rf, perm);
+    long long bestscore = score;
+    if (trace) emit(rf, trace, monotonic_ms() - start, bestscore, best);
+
+    double t0 = n > 1 ? 2.0 * absum / ((double)n * (n - 1)) : 1.0;
+    if (t0 <= 0) t0 = 1.0;
+    double logratio = log(1.0 / 200.0);
+    double temp = t0;
+    int emitted = 1;                   // Incumbent already written
+    uint64_t rng = rf->opts.seed;
+    long long moves = 0;
+
+    while (n > 1) {
+        if (limit <= 0 && moves >= maxmoves) break;
+        if (moves % ANNEAL_CHECK == 0) {
+            double elapsed = monotonic_ms() - start;
+            double progress = limit > 0 ? elapsed / limit : (double)moves / maxmoves;
+            if (progress >= 1.0) break;
+            temp = t0 * exp(logratio * progress);
+            if (trace && !emitted) {
+                emit(rf, trace, elapsed, bestscore, best);
+                emitted = 1;
+            }
+        }
+        moves++;
+
+        int i = rng_below(&rng, n), j = rng_below(&rng, n - 1);
+        if (j >= i) j++;
+        int c = perm[i];
+        const int *row = &PREF(rf, c, 0);
+        long long acc = 0, delta;
+        if (j < i) {
+            for (int k = j; k < i; k++) acc += row[perm[k]];
+            delta = 2 * acc;
+        } else {
+            for (int k = i + 1; k <= j; k++) acc += row[perm[k]];
+            delta = -2 * acc;
+        }
+
+        if (delta < 0) {
+            double u = (rng_next(&rng) >> 11) * 0x1p-53;
+            if (u >= exp(delta / temp)) continue;
+        }
+
+        if (j < i) memmove(&perm[j + 1], &perm[j], (i - j) * sizeof(int));
+        else memmove(&perm[i], &perm[i + 1], (j - i) * sizeof(int));
+        perm[j] = c;
+        score += delta;
+
+        if (score > bestscore) {
+            bestscore = score;
+            memcpy(best, perm, n * sizeof(int));
+            emitted = 0;
+        }
+    }
+    if (trace && !emitted) emit(rf, trace, monotonic_ms() - start, bestscore, best);
+
+    rf->stats.nodes = moves;
+    free(perm);
+    return bestscore;
+}
+
+//-----------------------------------------------------
+// Fills perm with the best ranking found within the
+// budget and returns its score
+//-----------------------------------------------------
+long long anneal_kemeny_solve(RanksFile *rf, int *perm) {
+    return anneal_run(rf, perm, NULL);
+}
+
+//-----------------------------------------------------
+// Runs the annealing on the whole instance, streaming each
+// new incumbent, then prints the final ranking. It is not
+// split by kemeny_solve, so the time budget covers the
+// whole run.
+//-----------------------------------------------------
+void compute_anneal_kemeny(RanksFile *rf, FILE *outfile) {
+    int n = rf->ncands;
+    int *perm = malloc((n > 0 ? n : 1) * sizeof(int));
+
+    if (rf->opts.time_limit_ms > 0)
+        fprintf(outfile, "\nAnytime Kemeny (simulated annealing, %lld ms budget)...\n", rf->opts.time_limit_ms);
+    else
+        fprintf(outfile, "\nAnytime Kemeny (simulated annealing, %lld moves)...\n",
+                (long long)ANNEAL_MOVES_PER_CAND * n);
+
+    long long score = perm ? anneal_run(rf, perm, outfile) : KEMENY_NO_SCORE;
+    if (score == KEMENY_NO_SCORE) {
+        fprintf(outfile, "Anytime Kemeny: out of memory.\n");
+        free(perm);
+        return;
+    }
+
+    fprintf(outfile, "\nAnytime Kemeny ranking (score = %lld, %lld moves): ", score, rf->stats.nodes);
+    for (int i = 0; i < n; i++) {
+        fprintf(outfile, "%s ", rf->unnames[perm[i]]);
+    }
+    fprintf(outfile, "\n");
+
+    free(perm);
+}
@@ -0,0 +1,439 @@
+// kemeny_bench.c
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <time.h>
+#include "ranksfile.h"
+
+//----------------------------------------------------------
+// Benchmark harness
+//----------------------------------------------------------
+// Times the ranking methods on synthetic elections, over a
+// grid of candidates x voters x generator model, and on
+// election files. Build it like kemeny.c, with the library
+// sources listed in setup.py.
+//
+// Usage: kemeny_bench [--methods LIST] [--models LIST]
+//                     [--cands LIST] [--voters LIST]
+//                     [--warmup N] [--reps N] [--max-ms N]
+//                     [--threads N] [--seed N] [--node-limit N]
+//                     [--time-limit-ms N] [--output FILE]
+//                     [DIR|MANIFEST|FILE...]
+//
+// The models are those of dataset_generator.py, with the
+// parameters the Python benchmarks use: uniform, mallows
+// (phi = 0.7), pl (Plackett-Luce, weights drawn from
+// U(0.1, 2)) and cycle (rotations of one order, swap noise
+// 0.2). --models none skips the grid, so only the files run;
+// they are collected as in batch mode. Each generated
+// election is built with ranksfile_from_positions, the path
+// the Python bindings take.
+//
+// For every election, the build (generated positions ->
+// RanksFile, or file -> RanksFile) and then each method get
+// --warmup untimed runs and --reps timed ones. The margins,
+// tournament and components are dropped before every run, so
+// each run pays for what the method needs, as a single call
+// from Python would. --max-ms caps the time spent on one
+// method and election: no more runs start once it is used up,
+// but at least one run is timed. Times use a monotonic clock.
+//
+// Output is one JSON line per method and election:
+//
+//   {"source": "uniform", "candidates": n, "voters": v,
+//    "method": ..., "threads": t, "warmup": w, "reps": r,
+//    "score": s, "median_ms": ..., "p95_ms": ...,
+//    "min_ms": ..., "max_ms": ..., "mean_ms": ...}
+//
+// Files have "source": "file" and a "file" entry. "reps" is
+// the number of timed runs actually made; the build has
+// method "build" and no score. A method that cannot run on
+// the election has null score and times. bench_loader.py
+// reads these records for the plotting scripts.
+//----------------------------------------------------------
+
+#define MAX_LIST 64
+
+static const char *MODELS[] = { "uniform", "mallows", "pl", "cycle" };
+#define NMODELS ((int)(sizeof(MODELS) / sizeof(MODELS[0])))
+
+typedef struct {
+    int warmup, reps;
+    double max_ms;
+    const KemenyMethod **sel;
+    int nsel;
+    FILE *out;
+} BenchConfig;
+
+// Uniform double in [0, 1)
+static double rng_double(uint64_t *state) {
+    return (rng_next(state) >> 11) * (1.0 / 9007199254740992.0);
+}
+
+//----------------------------------------------------------
+// Generators (see dataset_generator.py)
+//----------------------------------------------------------
+// Each fills order[] with one ballot, best candidate first;
+// remaining[] is scratch room for n ints.
+//----------------------------------------------------------
+static void gen_uniform(uint64_t *rng, int *order, int n) {
+    for (int i = 0; i < n; i++) order[i] = i;
+    for (int i = n - 1; i > 0; i--) {
+        int j = rng_below(rng, i + 1);
+        int t = order[i]; order[i] = order[j]; order[j] = t;
+    }
+}
+
+// Mallows around 0 < 1 < ... < n-1: each place takes the
+// k-th remaining candidate with probability ~ phi^k
+static void gen_mallows(uint64_t *rng, int *order, int n, double phi, int *remaining) {
+    for (int i = 0; i < n; i++) remaining[i] = i;
+    for (int i = n; i > 0; i--) {
+        double total = phi == 1.0 ? i : (1.0 - pow(phi, i)) / (1.0 - phi);
+        double u = rng_double(rng) * total, p = 1.0;
+        int k = 0;
+        while (k < i - 1 && u >= p) {
+            u -= p;
+            p *= phi;
+            k++;
+        }
+        order[n - i] = remaining[k];
+        memmove(&remaining[k], &remaining[k + 1], (i - k - 1) * sizeof(int));
+    }
+}
+
+// Plackett-Luce: places filled best first, each remaining
+// candidate drawn with probability proportional to its weight
+static void gen_plackett_luce(uint64_t *rng, int *order, int n, const double *weight, int *remaining) {
+    double total = 0;
+    for (int i = 0; i < n; i++) {
+        remaining[i] = i;
+        total += weight[i];
+    }
+    for (int i = n; i > 0; i--) {
+        double u = rng_double(rng) * total;
+        int k = 0;
+        while (k < i - 1 && u >= weight[remaining[k]]) u -= weight[remaining[k++]];
+        order[n - i] = remaining[k];
+        total -= weight[remaining[k]];
+        remaining[k] = remaining[i - 1];
+    }
+}
+
+// Cycle-heavy: the order 0 < 1 < ... rotated by a random
+// shift, then each place swapped with a random one with
+// probability noise
+static void gen_cycle(uint64_t *rng, int *order, int n, double noise) {
+    int shift = rng_below(rng, n);
+    for (int i = 0; i < n; i++) order[i] = (i + shift) % n;
+    for (int i = 0; i < n; i++) {
+        if (rng_double(rng) < noise) {
+            int j = rng_below(rng, n);
+            int t = order[i]; order[i] = order[j]; order[j] = t;
+        }
+    }
+}
+
+// Voters x candidates positions (pos[v * n + c], 0 = best)
+// from the model; NULL if out of memory
+static int *generate(const char *model, int n, int nvoters, uint64_t seed) {
+    int *pos = malloc((size_t)nvoters * n * sizeof(int) + 1);
+    int *order = malloc((n + 1) * sizeof(int));
+    int *remaining = malloc((n + 1) * sizeof(int));
+    double *weight = malloc((n + 1) * sizeof(double));
+    uint64_t rng = seed;
+
+    if (pos && order && remaining && weight) {
+        for (int c = 0; c < n; c++) weight[c] = 0.1 + 1.9 * rng_double(&rng);
+        for (int v = 0; v < nvoters; v++) {
+            if (strcmp(model, "mallows") == 0) gen_mallows(&rng, order, n, 0.7, remaining);
+            else if (strcmp(model, "pl") == 0) gen_plackett_luce(&rng, order, n, weight, remaining);
+            else if (strcmp(model, "cycle") == 0) gen_cycle(&rng, order, n, 0.2);
+            else gen_uniform(&rng, order, n);
+            for (int i = 0; i < n; i++) pos[(size_t)v * n + order[i]] = i;
+        }
+    } else {
+        free(pos);
+        pos = NULL;
+    }
+    free(order);
+    free(remaining);
+    free(weight);
+    return pos;
+}
+
+//----------------------------------------------------------
+// Timing and records
+//----------------------------------------------------------
+
+static int by_value(const void *a, const void *b) {
+    double x = *(const double *)a, y = *(const double *)b;
+    return (x > y) - (x < y);
+}
+
+// Drops what methods build on first use, so the next run
+// builds it again
+static void drop_derived(RanksFile *rf) {
+    margin_destroy(rf->margins);
+    tournament_destroy(rf->tournament);
+    components_destroy(rf->components);
+    rf->margins = NULL;
+    rf->tournament = NULL;
+    rf->components = NULL;
+}
+
+// Writes one record; times[0..k) are sorted in place, and
+// k == 0 gives null times
+static void write_record(const BenchConfig *bc, const char *source, const char *file, int n, int nvoters,
+                         const char *method, int nthreads, int hasscore, long long score, double *times, int k) {
+    FILE *out = bc->out;
+    fprintf(out, "{\"source\": ");
+    json_string(out, source);
+    if (file) {
+        fprintf(out, ", \"file\": ");
+        json_string(out, file);
+    }
+    fprintf(out, ", \"candidates\": %d, \"voters\": %d, \"method\": ", n, nvoters);
+    json_string(out, method);
+    fprintf(out, ", \"threads\": %d, \"warmup\": %d, \"reps\": %d, \"score\": ", nthreads, bc->warmup, k);
+    if (hasscore) fprintf(out, "%lld", score);
+    else fprintf(out, "null");
+
+    if (k == 0) {
+        fprintf(out, ", \"median_ms\": null, \"p95_ms\": null, \"min_ms\": null, \"max_ms\": null, "
+                "\"mean_ms\": null}\n");
+    } else {
+        qsort(times, k, sizeof(double), by_value);
+        double sum = 0;
+        for (int i = 0; i < k; i++) sum += times[i];
+        double median = (k % 2) ? times[k / 2] : (times[k / 2 - 1] + times[k / 2]) / 2;
+        int p95 = (int)ceil(0.95 * k) - 1;   // Nearest rank
+        fprintf(out, ", \"median_ms\": %.6f, \"p95_ms\": %.6f, \"min_ms\": %.6f, \"max_ms\": %.6f, "
+                "\"mean_ms\": %.6f}\n", median, times[p95], times[0], times[k - 1], sum / k);
+    }
+    fflush(out);
+}
+
+// Runs every selected method on rf and writes its record
+static void bench_methods(const BenchConfig *bc, RanksFile *rf, const char *source, const char *file,
+                          double *times) {
+    int n = rf->ncands;
+    int *perm = malloc((n > 0 ? n : 1) * sizeof(int));
+    if (!perm) return;
+
+    for (int m = 0; m < bc->nsel; m++) {
+        const KemenyMethod *method = bc->sel[m];
+        long long score = KEMENY_NO_SCORE;
+        double spent = 0;
+        int k = 0;
+
+        for (int w = 0; w < bc->warmup && (bc->max_ms <= 0 || spent < bc->max_ms); w++) {
+            drop_derived(rf);
+            double t0 = monotonic_ms();
+            score = kemeny_method_solve(rf, method, perm);
+            spent += monotonic_ms() - t0;
+            if (score == KEMENY_NO_SCORE) break;
+        }
+        while (k < bc->reps && (k == 0 || bc->max_ms <= 0 || spent < bc->max_ms)) {
+            drop_derived(rf);
+            double t0 = monotonic_ms();
+            score = kemeny_method_solve(rf, method, perm);
+            times[k] = monotonic_ms() - t0;
+            spent += times[k];
+            if (score == KEMENY_NO_SCORE) break;
+            k++;
+        }
+
+        int ok = score != KEMENY_NO_SCORE;
+        write_record(bc, source, file, n, rf->nrankers, method->name, ranksfile_threads(rf), ok, score, times,
+                     ok ? k : 0);
+        fprintf(stderr, "  %-12s %s\n", method->name, ok ? "done" : "cannot run");
+    }
+    free(perm);
+}
+
+// Splits a comma-separated list of positive numbers into
+// out[]; returns the count, -1 if an entry is not a number
+static int parse_ints(const char *list, int *out, int max) {
+    int k = 0;
+    const char *p = list;
+    while (*p && k < max) {
+        char *end;
+        long v = strtol(p, &end, 10);
+        if (end == p || v <= 0 || (*end != ',' && *end != '\0')) return -1;
+        out[k++] = (int)v;
+        p = *end ? end + 1 : end;
+    }
+    return k;
+}
+
+//----------------------------------------------------------
+// main function
+//----------------------------------------------------------
+int main(int argc, char **argv) {
+    const char *methods = "all", *models = "uniform,mallows,pl,cycle";
+    const char *cands = "8,16,32,64", *voters = "100,1000";
+    const char *outpath = NULL;
+    const char **inputs = malloc(argc * sizeof(char *));
+    int ninputs = 0;
+    const KemenyMethod *sel[MAX_LIST];
+    BenchConfig bc = { .warmup = 1, .reps = 5, .max_ms = 10000 };
+    uint64_t seed = 1;
+
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "--methods") == 0 && i + 1 < argc) {
+            methods = argv[++i];
+        } else if (strcmp(argv[i], "--models") == 0 && i + 1 < argc) {
+            models = argv[++i];
+        } else if (strcmp(argv[i], "--cands") == 0 && i + 1 < argc) {
+            cands = argv[++i];
+        } else if (strcmp(argv[i], "--voters") == 0 && i + 1 < argc) {
+            voters = argv[++i];
+        } else if (strcmp(argv[i], "--warmup") == 0 && i + 1 < argc) {
+            bc.warmup = atoi(argv[++i]);
+        } else if (strcmp(argv[i], "--reps") == 0 && i + 1 < argc) {
+            bc.reps = atoi(argv[++i]);
+        } else if (strcmp(argv[i], "--max-ms") == 0 && i + 1 < argc) {
+            bc.max_ms = atof(argv[++i]);
+        } else if (strcmp(argv[i], "--threads") == 0 && i + 1 < argc) {
+            kemeny_default_options.nthreads = atoi(argv[++i]);
+        } else if (strcmp(argv[i], "--seed") == 0 && i + 1 < argc) {
+            seed = strtoull(argv[++i], NULL, 10);
+            kemeny_default_options.seed = seed;
+        } else if (strcmp(argv[i], "--node-limit") == 0 && i + 1 < argc) {
+            kemeny_default_options.node_limit = atoll(argv[++i]);
+        } else if (strcmp(argv[i], "--time-limit-ms") == 0 && i + 1 < argc) {
+            kemeny_default_options.time_limit_ms = atoll(argv[++i]);
+        } else if (strcmp(argv[i], "--output") == 0 && i + 1 < argc) {
+            outpath = argv[++i];
+        } else if (argv[i][0] == '-') {
+            fprintf(stderr, "Usage: %s [--methods LIST] [--models LIST] [--cands LIST] [--voters LIST]\n"
+                    "       [--warmup N] [--reps N] [--max-ms N] [--threads N] [--seed N]\n"
+                    "       [--node-limit N] [--time-limit-ms N] [--output FILE] [DIR|MANIFEST|FILE...]\n",
+                    argv[0]);
+            return 1;
+        } else if (inputs) {
+            inputs[ninputs++] = argv[i];
+        }
+    }
+
+    // Check the whole grid before running anything
+    int ncand = 0, nvoter = 0, nmodel = 0;
+    int candv[MAX_LIST], voterv[MAX_LIST];
+    const char *modelv[NMODELS];
+    bc.sel = sel;
+    bc.nsel = kemeny_select_methods(methods, sel, MAX_LIST);
+    if (bc.nsel < 0) return 1;
+    if (strcmp(models, "none") != 0) {
+        ncand = parse_ints(cands, candv, MAX_LIST);
+        nvoter = parse_ints(voters, voterv, MAX_LIST);
+        if (ncand < 0 || nvoter < 0) {
+            fprintf(stderr, "--cands and --voters take comma-separated positive numbers\n");
+            return 1;
+        }
+        for (const char *p = models; *p; ) {
+            size_t len = strcspn(p, ",");
+            int found = -1;
+            for (int m = 0; m < NMODELS; m++)
+                if (strlen(MODELS[m]) == len && strncmp(MODELS[m], p, len) == 0) found = m;
+            if (found < 0) {
+                fprintf(stderr, "Unknown model '%.*s'. Models are uniform, mallows, pl, cycle (or none)\n",
+                        (int)len, p);
+                return 1;
+            }
+            if (nmodel < NMODELS) modelv[nmodel++] = MODELS[found];
+            p += len + (p[len] == ',');
+        }
+    }
+    if (bc.warmup < 0) bc.warmup = 0;
+    if (bc.reps < 1) bc.reps = 1;
+
+    char **files = NULL;
+    int nfiles = ninputs > 0 ? kemeny_list_elections(inputs, ninputs, &files) : 0;
+    free(inputs);
+    if (nfiles < 0) return 1;
+
+    bc.out = outpath ? fopen(outpath, "w") : stdout;
+    if (!bc.out) {
+        fprintf(stderr, "Cannot write %s\n", outpath);
+        return 1;
+    }
+    double *times = malloc((bc.reps + 1) * sizeof(double));
+    if (!times) return 1;
+    RanksFile probe = { .opts = kemeny_default_options };
+    int nthreads = ranksfile_threads(&probe);
+    int failed = 0;
+
+    // The synthetic grid
+    for (int mi = 0; mi < nmodel; mi++) {
+        for (int ci = 0; ci < ncand; ci++) {
+            for (int vi = 0; vi < nvoter; vi++) {
+                int n = candv[ci], nv = voterv[vi];
+                uint64_t cell = seed ^ ((uint64_t)(mi + 1) << 48) ^ ((uint64_t)n << 24) ^ (uint64_t)nv;
+                fprintf(stderr, "%s, %d candidates, %d voters\n", modelv[mi], n, nv);
+                int *pos = generate(modelv[mi], n, nv, rng_next(&cell));
+                if (!pos) {
+                    fprintf(stderr, "  out of memory\n");
+                    failed++;
+                    continue;
+                }
+
+                RanksFile *rf = NULL;
+                int k = 0;
+                double spent = 0;
+                for (int r = 0; r < bc.warmup + bc.reps; r++) {
+                    if (r > bc.warmup && bc.max_ms > 0 && spent >= bc.max_ms) break;
+                    ranksfile_destroy(rf);
+                    double t0 = monotonic_ms();
+                    rf = ranksfile_from_positions(pos, sizeof(int), (ptrdiff_t)n * sizeof(int), sizeof(int),
+                                                  nv, n, &kemeny_default_options);
+                    double t = monotonic_ms() - t0;
+                    if (!rf) break;
+                    spent += t;
+                    if (r >= bc.warmup) times[k++] = t;
+                }
+                free(pos);
+                if (!rf) {
+                    fprintf(stderr, "  out of memory\n");
+                    failed++;
+                    continue;
+                }
+                write_record(&bc, modelv[mi], NULL, n, nv, "build", nthreads, 0, 0, times, k);
+                bench_methods(&bc, rf, modelv[mi], NULL, times);
+                ranksfile_destroy(rf);
+            }
+        }
+    }
+
+    // The election files
+    for (int f = 0; f < nfiles; f++) {
+        fprintf(stderr, "%s\n", files[f]);
+        RanksFile *rf = NULL;
+        int k = 0;
+        double spent = 0;
+        for (int r = 0; r < bc.warmup + bc.reps; r++) {
+            if (r > bc.warmup && bc.max_ms > 0 && spent >= bc.max_ms) break;
+            ranksfile_destroy(rf);
+            double t0 = monotonic_ms();
+            rf = read_election(files[f], NULL, 0);
+            double t = monotonic_ms() - t0;
+            if (!rf) break;
+            spent += t;
+            if (r >= bc.warmup) times[k++] = t;
+        }
+        if (rf) {
+            write_record(&bc, "file", files[f], rf->ncands, rf->nrankers, "build", nthreads, 0, 0, times, k);
+            bench_methods(&bc, rf, "file", files[f], times);
+            ranksfile_destroy(rf);
+        } else {
+            failed++;
+        }
+        free(files[f]);
+    }
+    free(files);
+    free(times);
+
+    if (bc.out != stdout) fclose(bc.out);
+    return failed != 0;
+}
@@ -0,0 +1,214 @@
+// kemeny_bnb.c
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "ranksfile.h"
+
+//-----------------------------------------------------
+// Branch-and-bound exact Kemeny consensus
+//-----------------------------------------------------
+// Builds the ranking prefix by prefix, depth first. When a
+// candidate c is appended, every pair (c, x) with x still
+// unplaced is settled, so the prefix score grows by
+// gain[c] = sum of m(c,x) over the unplaced x.
+//
+// The pairs among the unplaced candidates can contribute at
+// most the better of their two outcomes, |m(x,y)|, so
+//
+//   bound = prefix score + sum over unplaced pairs of |m|
+//
+// is admissible, and a prefix is dropped as soon as its
+// bound cannot beat the incumbent. gain[] and abs[] (the
+// per-candidate sums of m and |m| against the unplaced set)
+// are updated in O(n) per node.
+//
+// The incumbent starts from heuristic_kemeny_solve.
+// Children are tried in decreasing gain (Borda score among
+// the unplaced candidates), and a child c that loses to the
+// previously placed candidate (m(prev, c) < 0) is skipped:
+// swapping such an adjacent pair always improves a ranking,
+// so some optimum never contains it.
+//-----------------------------------------------------
+
+typedef struct {
+    RanksFile *rf;
+    int n;
+    int *prefix;          // Current partial ranking
+    char *placed;         // placed[c] = 1 if c is in the prefix
+    long long *gain;      // Sum of m(c,x) over unplaced x
+    long long *abs;       // Sum of |m(c,x)| over unplaced x
+    long long restbound;  // Sum of |m| over unplaced pairs
+    long long best;       // Incumbent score
+    int *bestperm;        // Incumbent ranking
+    int *kids;            // Child stack, n - d slots at depth d
+    long long nodes;      // Nodes explored
+    long long limit;      // Node budget, 0 = none
+    int aborted;          // Budget exhausted
+    long long openbound;  // Best bound left unexplored when aborted
+} BnB;
+
+static inline long long labs_ll(long long v) { return v < 0 ? -v : v; }
+
+static void search(BnB *b, int depth, long long score) {
+    int n = b->n;
+    RanksFile *rf = b->rf;
+    long long bound = score + b->restbound;
+
+    if (b->limit && b->nodes >= b->limit) {
+        b->aborted = 1;
+        if (bound > b->openbound) b->openbound = bound;
+        return;
+    }
+    b->nodes++;
+
+    if (depth == n) {
+        if (score > b->best) {
+            b->best = score;
+            memcpy(b->bestperm, b->prefix, n * sizeof(int));
+        }
+        return;
+    }
+    if (bound <= b->best) return;   // Cannot beat the incumbent
+
+    // Children: unplaced candidates by decreasing gain
+    int *kids = b->kids + (size_t)depth * n - (size_t)depth * (depth - 1) / 2;
+    int nk = 0;
+    int prev = depth > 0 ? b->prefix[depth - 1] : -1;
+    for (int c = 0; c < n; c++) {
+        if (b->placed[c]) continue;
+        if (prev >= 0 && PREF(rf, prev, c) < 0) continue;   // Adjacent swap would improve
+        int k = nk++;
+        while (k > 0 && b->gain[kids[k - 1]] < b->gain[c]) {
+            kids[k] = kids[k - 1];
+            k--;
+        }
+        kids[k] = c;
+    }
+
+    for (int k = 0; k < nk; k++) {
+        int c = kids[k];
+        long long childscore = score + b->gain[c];
+        long long oldrest = b->restbound;
+
+        // Child bound before descending
+        if (childscore + oldrest - b->abs[c] <= b->best) continue;
+
+        // Place c: settle its pairs with the unplaced set
+        b->placed[c] = 1;
+        b->prefix[depth] = c;
+        b->restbound -= b->abs[c];
+        for (int x = 0; x < n; x++) {
+            if (b->placed[x]) continue;
+            int m = PREF(rf, x, c);
+            b->gain[x] -= m;
+            b->abs[x] -= labs_ll(m);
+        }
+
+        search(b, depth + 1, childscore);
+
+        // Undo
+        for (int x = 0; x < n; x++) {
+            if (b->placed[x]) continue;
+            int m = PREF(rf, x, c);
+            b->gain[x] += m;
+            b->abs[x] += labs_ll(m);
+        }
+        b->restbound = oldrest;
+        b->placed[c] = 0;
+
+        if (b->aborted) {
+            // Remaining children are bounded by this node's bound
+            if (bound > b->openbound) b->openbound = bound;
+            break;
+        }
+    }
+}
+
+// Runs the search; returns the incumbent score, or
+// KEMENY_NO_SCORE if out of memory
+static long long bnb_run(RanksFile *rf, int *perm, long long *nodes, long long *gap) {
+    int n = rf->ncands;
+    BnB b;
+    memset(&b, 0, sizeof(BnB));
+    b.rf = rf;
+    b.n = n;
+    b.limit = rf->opts.node_limit;
+    b.prefix = malloc((n > 0 ? n : 1) * sizeof(int));
+    b.placed = calloc(n > 0 ? n : 1, 1);
+    b.gain = calloc(n > 0 ? n : 1, sizeof(long long));
+    b.abs = calloc(n > 0 ? n : 1, sizeof(long long));
+    b.kids = malloc(((size_t)n * (n + 1) / 2 + 1) * sizeof(int));
+    b.bestperm = perm;
+    if (!b.prefix || !b.placed || !b.gain || !b.abs || !b.kids) {
+        free(b.prefix);
+        free(b.placed);
+        free(b.gain);
+        free(b.abs);
+        free(b.kids);
+        return KEMENY_NO_SCORE;
+    }
+    b.openbound = KEMENY_NO_SCORE;
+
+    // Incumbent from the local search heuristic
+    b.best = heuristic_kemeny_solve(rf, perm);
+    if (b.best == KEMENY_NO_SCORE) {
+        for (int i = 0; i < n; i++) perm[i] = i;
+        b.best = KEMENY_NO_SCORE + 1;
+    }
+
+    for (int c = 0; c < n; c++) {
+        for (int x = 0; x < n; x++) {
+            int m = PREF(rf, c, x);
+            b.gain[c] += m;
+            b.abs[c] += labs_ll(m);
+            if (x > c) b.restbound += labs_ll(m);
+        }
+    }
+
+    search(&b, 0, 0);
+
+    *nodes = b.nodes;
+    *gap = (b.aborted && b.openbound > b.best) ? b.openbound - b.best : 0;
+
+    free(b.prefix);
+    free(b.placed);
+    free(b.gain);
+    free(b.abs);
+    free(b.kids);
+    return b.best;
+}
+
+//-----------------------------------------------------
+// Fills perm with the best ranking found and returns its
+// score; it is optimal unless opts.node_limit was hit. The
+// nodes explored and the gap are left in rf->stats.
+//-----------------------------------------------------
+long long kemeny_bnb_solve(RanksFile *rf, int *perm) {
+    return bnb_run(rf, perm, &rf->stats.nodes, &rf->stats.gap);
+}
+
+//-----------------------------------------------------
+// Prints the branch-and-bound result with the number of
+// nodes explored and the proven optimality gap
+//-----------------------------------------------------
+void compute_kemeny_branch_bound(RanksFile *rf, FILE *out) {
+    int n = rf->ncands;
+    int *perm = malloc((n > 0 ? n : 1) * sizeof(int));
+
+    fprintf(out, "\nComputing Kemeny consensus (branch and bound)...\n");
+    long long score = kemeny_solve(rf, kemeny_bnb_solve, perm);
+    if (score == KEMENY_NO_SCORE) {
+        fprintf(out, "Branch and bound: out of memory.\n");
+        free(perm);
+        return;
+    }
+    long long nodes = rf->stats.nodes, gap = rf->stats.gap;
+
+    fprintf(out, "\nBest Kemeny score: %lld (%s, %lld nodes explored, gap %lld)\nBest ranking: ",
+            score, gap ? "node limit reached" : "optimal", nodes, gap);
+    for (int i = 0; i < n; i++) {
+        fprintf(out, "%s ", rf->unnames[perm[i]]);
+    }
+    fprintf(out, "\n");
+    free(perm);
+}
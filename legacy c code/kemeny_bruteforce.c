@@ -1,50 +1,184 @@
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include <pthread.h>
 #include "ranksfile.h"  // we'll make a header file with RanksFile struct
 
+//-----------------------------------------------------
+// Brute force over all rankings
+//-----------------------------------------------------
+// The rankings are split by their first PREFIX_LEN
+// candidates into n(n-1) tasks, which worker threads take
+// from a shared counter. Inside a task the remaining
+// candidates are enumerated in plain-change order (Steinhaus-
+// Johnson-Trotter, Knuth's Algorithm P), where consecutive
+// rankings differ by one adjacent swap. Swapping a directly
+// above b for b directly above a changes the score by
+// -2 m(a,b), so each ranking costs O(1) instead of a fresh
+// O(n^2) score.
+//
+// Ties keep the ranking from the lowest task, first in
+// plain-change order, so the result does not depend on the
+// number of threads.
+//-----------------------------------------------------
+
+#define PREFIX_LEN 2
+
+typedef struct {
+    RanksFile *rf;
+    int n;
+    int prefixlen;
+    int ntasks;
+    int next;                 // Next task to hand out
+    long long best;           // Shared best score
+    int besttask;             // Task that found it
+    int *bestperm;
+    pthread_mutex_t lock;
+} BruteForce;
+
 //-----------------------------------------------------
 // Helper: compute Kemeny score for a given ranking
 //-----------------------------------------------------
-static int compute_kemeny_score(int *ranking, RanksFile *rf) {
-    int score = 0;
+static long long compute_kemeny_score(const int *ranking, RanksFile *rf) {
+    long long score = 0;
     for (int i = 0; i < rf->ncands; i++) {
         for (int j = i + 1; j < rf->ncands; j++) {
             int a = ranking[i];
             int b = ranking[j];
-            score += rf->prefmat[a][b]; // Add preference difference
+            score += PREF(rf, a, b); // Add preference difference
         }
     }
     return score;
 }
 
-//-----------------------------------------------------
-// Helper: swap two integers (used for permutations)
-//-----------------------------------------------------
-static void swap(int *a, int *b) {
-    int tmp = *a;
-    *a = *b;
-    *b = tmp;
+// Ranking of task t: its prefix, then the other candidates in order
+static void task_ranking(const BruteForce *bf, int t, int *arr) {
+    int n = bf->n;
+    char used[n];
+    memset(used, 0, n);
+    int rest = t;
+    for (int i = 0; i < bf->prefixlen; i++) {
+        int k = rest % (n - i);   // k-th unused candidate
+        rest /= n - i;
+        for (int c = 0; c < n; c++) {
+            if (used[c]) continue;
+            if (k-- == 0) {
+                arr[i] = c;
+                used[c] = 1;
+                break;
+            }
+        }
+    }
+    int m = bf->prefixlen;
+    for (int c = 0; c < n; c++)
+        if (!used[c]) arr[m++] = c;
 }
 
 //-----------------------------------------------------
-// Recursive permutation generator for brute force search
+// Worker: enumerates the suffixes of each task it takes
+// and publishes its best into the shared slot
 //-----------------------------------------------------
-static void permute(RanksFile *rf, int *arr, int l, int r, int *best_score, int *best_perm) {
-    if (l == r) {
-        int score = compute_kemeny_score(arr, rf);
-        if (score > *best_score) {
-            *best_score = score;
-            memcpy(best_perm, arr, rf->ncands * sizeof(int));
+static void *bruteforce_worker(void *arg) {
+    BruteForce *bf = *(BruteForce **)arg;
+    RanksFile *rf = bf->rf;
+    int n = bf->n;
+    int r = n - bf->prefixlen;       // Length of the enumerated suffix
+    int arr[n + 1], best_perm[n];
+    int c[r + 1], o[r + 1];
+
+    for (;;) {
+        pthread_mutex_lock(&bf->lock);
+        int t = bf->next++;
+        pthread_mutex_unlock(&bf->lock);
+        if (t >= bf->ntasks) break;
+
+        task_ranking(bf, t, arr);
+        long long score = compute_kemeny_score(arr, rf);
+        long long best_score = score;
+        memcpy(best_perm, arr, n * sizeof(int));
+
+        // Algorithm P on a[1..r] = arr[prefixlen .. n-1]
+        int *a = arr + bf->prefixlen - 1;
+        for (int j = 1; j <= r; j++) {
+            c[j] = 0;
+            o[j] = 1;
         }
-        return;
+        int j = r, s = 0;
+        while (j > 0) {
+            int q = c[j] + o[j];
+            if (q < 0) {
+                o[j] = -o[j];
+                j--;
+                continue;
+            }
+            if (q == j) {
+                if (j == 1) break;
+                s++;
+                o[j] = -o[j];
+                j--;
+                continue;
+            }
+            int x = j - c[j] + s, y = j - q + s;
+            int lo = x < y ? x : y;
+            score -= 2LL * PREF(rf, a[lo], a[lo + 1]);
+            int tmp = a[x];
+            a[x] = a[y];
+            a[y] = tmp;
+            c[j] = q;
+            if (score > best_score) {
+                best_score = score;
+                memcpy(best_perm, arr, n * sizeof(int));
+            }
+            j = r;
+            s = 0;
+        }
+
+        pthread_mutex_lock(&bf->lock);
+        if (best_score > bf->best || (best_score == bf->best && t < bf->besttask)) {
+            bf->best = best_score;
+            bf->besttask = t;
+            memcpy(bf->bestperm, best_perm, n * sizeof(int));
+        }
+        pthread_mutex_unlock(&bf->lock);
     }
+    return NULL;
+}
+
+//-----------------------------------------------------
+// Fills perm with an optimal ranking and returns its
+// score, or KEMENY_NO_SCORE if there are more than
+// BRUTEFORCE_MAXCANDS candidates or memory runs out.
+//-----------------------------------------------------
+long long kemeny_bruteforce_solve(RanksFile *rf, int *perm) {
+    int n = rf->ncands;
+    if (n > BRUTEFORCE_MAXCANDS) return KEMENY_NO_SCORE;
+    if (n == 0) return 0;
 
-    for (int i = l; i <= r; i++) {
-        swap(&arr[l], &arr[i]);
-        permute(rf, arr, l + 1, r, best_score, best_perm);
-        swap(&arr[l], &arr[i]); // backtrack
+    BruteForce bf;
+    memset(&bf, 0, sizeof(BruteForce));
+    bf.rf = rf;
+    bf.n = n;
+    bf.prefixlen = n > PREFIX_LEN ? PREFIX_LEN : 0;
+    bf.ntasks = 1;
+    for (int i = 0; i < bf.prefixlen; i++) bf.ntasks *= n - i;
+    bf.best = KEMENY_NO_SCORE;
+    bf.besttask = bf.ntasks;
+    bf.bestperm = perm;
+    pthread_mutex_init(&bf.lock, NULL);
+
+    int nthreads = ranksfile_threads(rf);
+    if (nthreads > bf.ntasks) nthreads = bf.ntasks;
+    BruteForce **args = malloc(nthreads * sizeof(BruteForce *));
+    if (!args) {
+        pthread_mutex_destroy(&bf.lock);
+        return KEMENY_NO_SCORE;
     }
+    for (int t = 0; t < nthreads; t++) args[t] = &bf;
+    run_parallel(bruteforce_worker, args, sizeof(BruteForce *), nthreads);
+    free(args);
+
+    pthread_mutex_destroy(&bf.lock);
+    return bf.best;
 }
 
 //-----------------------------------------------------
@@ -55,25 +189,28 @@ static void permute(RanksFile *rf, int *arr, int l, int r, int *best_score, int
 // Prints the result directly.
 //-----------------------------------------------------
 void compute_kemeny_bruteforce(RanksFile *rf, FILE *out) {
-    if (rf->ncands > 10) {
-        fprintf(out, "Too many candidates (%d). Brute force limited to <= 10.\n", rf->ncands);
+    int size = kemeny_solve_size(rf);
+    if (size > BRUTEFORCE_MAXCANDS) {
+        fprintf(out, "Too many candidates (%d). Brute force limited to <= %d.\n",
+                size, BRUTEFORCE_MAXCANDS);
         return;
     }
 
-    int arr[rf->ncands];
-    for (int i = 0; i < rf->ncands; i++)
-        arr[i] = i;
-
-    int best_score = -999999;
-    int best_perm[rf->ncands];
+    int n = rf->ncands;
+    int *best_perm = malloc((n > 0 ? n : 1) * sizeof(int));
 
     fprintf(out, "\nComputing Kemeny consensus (brute force)...\n");
-    permute(rf, arr, 0, rf->ncands - 1, &best_score, best_perm);
+    long long best_score = kemeny_solve(rf, kemeny_bruteforce_solve, best_perm);
+    if (best_score == KEMENY_NO_SCORE) {
+        fprintf(out, "Brute force: out of memory.\n");
+        free(best_perm);
+        return;
+    }
 
-    fprintf(out, "\nBest Kemeny score: %d\nBest ranking: ", best_score);
-    for (int i = 0; i < rf->ncands; i++) {
+    fprintf(out, "\nBest Kemeny score: %lld\nBest ranking: ", best_score);
+    for (int i = 0; i < n; i++) {
         fprintf(out, "%s ", rf->unnames[best_perm[i]]);
     }
     fprintf(out, "\n");
+    free(best_perm);
 }
-
@@ -0,0 +1,231 @@
+// kemeny_dp.c
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include "ranksfile.h"
+
+//-----------------------------------------------------
+// Exact Kemeny consensus by dynamic programming over
+// subsets (Held-Karp style), as kemeny_dp_by_candidates
+// in algorithms.py:
+//
+//   dp[S]   = best score of a ranking of the subset S
+//   last[S] = candidate ranked last in that ranking
+//   dp[S]   = max over i in S of dp[S - i] + col_i(S)
+//
+// where col_i(S) = sum of m(c,i) for c in S, the margin
+// gained by ranking every other member of S above i.
+//
+// Subsets are bitmasks. col_i(S) is read from per-
+// candidate tables over 8-bit chunks of the mask, each
+// entry built incrementally from the entry with its lowest
+// bit cleared, so one lookup per chunk replaces a loop over
+// the members of S. dp is int32 when no score can overflow
+// it (int64 otherwise) and last is one byte per subset.
+//
+// Subsets of the same size only depend on smaller ones, so
+// each size is split across threads: every thread unranks
+// its first subset and walks its share in Gosper order.
+//-----------------------------------------------------
+
+#define CHUNK 8
+#define CHUNKVALS (1 << CHUNK)
+
+typedef struct {
+    int n;
+    int nchunks;
+    int *col;             // col[(i * nchunks + q) * 256 + byte]
+    void *dp;             // int32_t or int64_t per subset
+    int wide;             // 1 if dp is int64_t
+    unsigned char *last;  // Last candidate per subset
+    long long binom[DP_MAXCANDS + 1][DP_MAXCANDS + 1];
+} DPState;
+
+typedef struct {
+    DPState *st;
+    int k;                // Subset size of this layer
+    long long first;      // Colex rank of the first subset
+    long long count;      // Number of subsets to process
+} DPTask;
+
+// Sum of m(c,i) over the members c of S
+static inline long long col_sum(const DPState *st, int i, uint32_t S) {
+    const int *t = &st->col[(size_t)i * st->nchunks * CHUNKVALS];
+    long long s = 0;
+    for (int q = 0; q < st->nchunks; q++, t += CHUNKVALS)
+        s += t[(S >> (q * CHUNK)) & (CHUNKVALS - 1)];
+    return s;
+}
+
+// The subset of size k with colex rank r (Gosper order)
+static uint32_t unrank(const DPState *st, int k, long long r) {
+    uint32_t S = 0;
+    int c = st->n - 1;
+    for (int j = k; j >= 1; j--) {
+        while (st->binom[c][j] > r) c--;
+        S |= 1u << c;
+        r -= st->binom[c][j];
+        c--;
+    }
+    return S;
+}
+
+#define DP_LAYER(T)                                                      \
+    do {                                                                 \
+        T *dp = (T *)st->dp;                                             \
+        for (long long done = 0; done < t->count; done++) {              \
+            long long best = 0;                                          \
+            int bestlast = -1;                                           \
+            for (uint32_t rest = S; rest; rest &= rest - 1) {            \
+                int i = __builtin_ctz(rest);                             \
+                long long v = dp[S ^ (1u << i)] + col_sum(st, i, S);     \
+                if (bestlast < 0 || v > best) {                          \
+                    best = v;                                            \
+                    bestlast = i;                                        \
+                }                                                        \
+            }                                                            \
+            dp[S] = (T)best;                                             \
+            st->last[S] = (unsigned char)bestlast;                       \
+            uint32_t low = S & -S, up = S + low;                         \
+            S = (((up ^ S) >> 2) / low) | up;   /* Gosper's hack */      \
+        }                                                                \
+    } while (0)
+
+static void *dp_layer(void *arg) {
+    DPTask *t = arg;
+    DPState *st = t->st;
+    if (t->count <= 0) return NULL;
+    uint32_t S = unrank(st, t->k, t->first);
+    if (st->wide) DP_LAYER(int64_t);
+    else DP_LAYER(int32_t);
+    return NULL;
+}
+
+//-----------------------------------------------------
+// Main callable function
+//-----------------------------------------------------
+// Fills perm with an optimal Kemeny ranking and returns
+// its score, or KEMENY_NO_SCORE if there are more than
+// DP_MAXCANDS candidates or memory runs out.
+//-----------------------------------------------------
+long long kemeny_dp_solve(RanksFile *rf, int *perm) {
+    int n = rf->ncands;
+    if (n > DP_MAXCANDS) return KEMENY_NO_SCORE;
+    if (n == 0) return 0;
+
+    const MarginMatrix *mm = ranksfile_margins(rf);
+    DPState *st = calloc(1, sizeof(DPState));
+    if (!mm || !st) {
+        free(st);
+        return KEMENY_NO_SCORE;
+    }
+    st->n = n;
+    st->nchunks = (n + CHUNK - 1) / CHUNK;
+
+    // Scores are bounded by the sum of |m| over all pairs
+    long long bound = 0;
+    for (int a = 0; a < n; a++)
+        for (int b = a + 1; b < n; b++)
+            bound += llabs((long long)margin_at(mm, a, b));
+    st->wide = bound > INT32_MAX;
+
+    size_t nsub = (size_t)1 << n;
+    st->col = malloc((size_t)n * st->nchunks * CHUNKVALS * sizeof(int));
+    st->dp = malloc(nsub * (st->wide ? sizeof(int64_t) : sizeof(int32_t)));
+    st->last = malloc(nsub);
+    int nthreads = ranksfile_threads(rf);
+    DPTask *tasks = malloc(nthreads * sizeof(DPTask));
+    if (!st->col || !st->dp || !st->last || !tasks) {
+        free(st->col);
+        free(st->dp);
+        free(st->last);
+        free(st);
+        free(tasks);
+        return KEMENY_NO_SCORE;
+    }
+
+    // Per-candidate chunk tables, each entry from its lowest-bit-cleared one
+    for (int i = 0; i < n; i++) {
+        for (int q = 0; q < st->nchunks; q++) {
+            int *t = &st->col[((size_t)i * st->nchunks + q) * CHUNKVALS];
+            t[0] = 0;
+            for (int byte = 1; byte < CHUNKVALS; byte++) {
+                int c = q * CHUNK + __builtin_ctz(byte);
+                t[byte] = t[byte & (byte - 1)] + (c < n ? margin_at(mm, c, i) : 0);
+            }
+        }
+    }
+
+    for (int a = 0; a <= n; a++) {
+        st->binom[a][0] = 1;
+        for (int b = 1; b <= n; b++)
+            st->binom[a][b] = (a == 0) ? 0 : st->binom[a - 1][b - 1] + st->binom[a - 1][b];
+    }
+
+    // Empty set and singletons
+    if (st->wide) ((int64_t *)st->dp)[0] = 0;
+    else ((int32_t *)st->dp)[0] = 0;
+    for (int i = 0; i < n; i++) {
+        if (st->wide) ((int64_t *)st->dp)[1u << i] = 0;
+        else ((int32_t *)st->dp)[1u << i] = 0;
+        st->last[1u << i] = (unsigned char)i;
+    }
+
+    // Layers by subset size, each split across threads
+    for (int k = 2; k <= n; k++) {
+        long long total = st->binom[n][k];
+        int nt = nthreads;
+        if (total < 4096) nt = 1;   // Not worth a thread
+        for (int t = 0; t < nt; t++) {
+            long long lo = total * t / nt, hi = total * (t + 1) / nt;
+            tasks[t] = (DPTask){ st, k, lo, hi - lo };
+        }
+        run_parallel(dp_layer, tasks, sizeof(DPTask), nt);
+    }
+    free(tasks);
+
+    // Walk back from the full set: last[] gives the worst first
+    uint32_t full = (uint32_t)(nsub - 1);
+    long long score = st->wide ? ((int64_t *)st->dp)[full] : ((int32_t *)st->dp)[full];
+    uint32_t S = full;
+    for (int pos = n - 1; pos >= 0; pos--) {
+        int i = st->last[S];
+        perm[pos] = i;
+        S ^= 1u << i;
+    }
+
+    free(st->col);
+    free(st->dp);
+    free(st->last);
+    free(st);
+    return score;
+}
+
+//-----------------------------------------------------
+// Prints the exact Kemeny consensus found by the DP
+//-----------------------------------------------------
+void compute_kemeny_dp(RanksFile *rf, FILE *out) {
+    int n = rf->ncands;
+    int size = kemeny_solve_size(rf);
+    if (size > DP_MAXCANDS) {
+        fprintf(out, "\nToo many candidates (%d). Subset DP limited to <= %d.\n", size, DP_MAXCANDS);
+        return;
+    }
+
+    int *perm = malloc((n > 0 ? n : 1) * sizeof(int));
+    fprintf(out, "\nComputing Kemeny consensus (subset DP)...\n");
+    long long score = kemeny_solve(rf, kemeny_dp_solve, perm);
+    if (score == KEMENY_NO_SCORE) {
+        fprintf(out, "Subset DP: out of memory.\n");
+        free(perm);
+        return;
+    }
+
+    fprintf(out, "\nBest Kemeny score: %lld\nBest ranking: ", score);
+    for (int i = 0; i < n; i++) {
+        fprintf(out, "%s ", rf->unnames[perm[i]]);
+    }
+    fprintf(out, "\n");
+    free(perm);
+}
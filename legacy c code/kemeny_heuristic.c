@@ -4,7 +4,7 @@
 #include <math.h>
 #include "ranksfile.h"
 
-#define MPERM 7   // Size of the local optimization window for small permutations
+#define WINDOW_ENUM_MAX 5   // Windows up to this size are enumerated, longer ones use the DP
 
 // =====================================================
 // Utility: Swap two integers (used for permutation manipulation)
@@ -19,38 +19,16 @@ static inline void swap(int *a, int *b) {
 // Compute the total Kemeny score for a given ranking (perm)
 // -----------------------------------------------------
 // The score measures how consistent the ranking is with
-// the pairwise preferences in rf->prefmat.
+// the pairwise preferences: the sum of the margins m(a,b)
+// over all pairs with a ranked above b.
 // Higher score = better agreement with voters.
+// Runs the vectorized kernel over the packed margin matrix;
+// pos is scratch space for n ints.
 // =====================================================
-static double compute_score(RanksFile *rf, int *perm) {
-    double score = 0.0;
-    int n = rf->ncands;
-    for (int i = 0; i < n - 1; i++) {
-        for (int j = i + 1; j < n; j++) {
-            int a = perm[i];
-            int b = perm[j];
-            score += (rf->prefmat[a][b] - rf->prefmat[b][a]);
-        }
-    }
-    return score;
-}
-
-// =====================================================
-// Compute partial Kemeny score for a subrange of candidates
-// -----------------------------------------------------
-// Used by the local permutation optimization to evaluate
-// only a small "window" (lo to hi) instead of all candidates.
-// =====================================================
-static double compute_partial_score(RanksFile *rf, int *perm, int lo, int hi) {
-    double score = 0.0;
-    for (int i = lo; i < hi; i++) {
-        for (int j = i + 1; j <= hi; j++) {
-            int a = perm[i];
-            int b = perm[j];
-            score += (rf->prefmat[a][b] - rf->prefmat[b][a]);
-        }
-    }
-    return score;
+static long long compute_score(const MarginMatrix *mm, const int *perm, int *pos) {
+    int n = mm->n;
+    for (int i = 0; i < n; i++) pos[perm[i]] = i;
+    return margin_score(mm, pos);
 }
 
 // =====================================================
@@ -62,37 +40,59 @@ static double compute_partial_score(RanksFile *rf, int *perm, int lo, int hi) {
 // For each candidate i:
 //   - Try inserting it at every other position j
 //   - Calculate how much the Kemeny score changes (delta)
-//   - Perform the best move if it increases the score
+//   - Perform the best (or first) move that increases the score
+//
+// Moving perm[i] to position j flips its pair with every
+// candidate it jumps over, so with g[k] = m(perm[i], perm[k])
+//
+//   delta(j) =  2 * (g[j] + ... + g[i-1])   for j < i
+//   delta(j) = -2 * (g[i+1] + ... + g[j])   for j > i
+//
+// Both sums grow by one term as j moves away from i, so one
+// outward sweep in each direction prices every target in
+// O(n), and a pass over all candidates costs O(n^2).
+//
+// With opts.first_improvement the sweep stops at the first
+// target that improves the score (nearest first, left side
+// before right); otherwise the best target is taken.
+// [*lo, *hi] is widened to cover every position changed.
+// row and g are scratch space for n ints each.
 // =====================================================
-static void move_insert(RanksFile *rf, int *perm, double *lastscore) {
-    int n = rf->ncands;
+static void move_insert(const MarginMatrix *mm, int *perm, long long *lastscore, int first, int *lo, int *hi,
+                        int *row, int *g) {
+    int n = mm->n;
 
     for (int i = 0; i < n; i++) {
-        double best_delta = 0.0;
+        long long best_delta = 0;
         int best_pos = i;
 
-        // Try inserting perm[i] at every other position j
-        for (int j = 0; j < n; j++) {
-            if (i == j) continue;
-            double delta = 0.0;
-
-            // Calculate delta for moving candidate i to j
-            if (j < i) {
-                for (int k = j; k < i; k++)
-                    delta += 2.0 * (rf->prefmat[perm[i]][perm[k]] - rf->prefmat[perm[k]][perm[i]]);
-            } else {
-                for (int k = i + 1; k <= j; k++)
-                    delta += 2.0 * (rf->prefmat[perm[k]][perm[i]] - rf->prefmat[perm[i]][perm[k]]);
+        margin_row(mm, perm[i], row);
+        for (int k = 0; k < n; k++) g[k] = row[perm[k]];
+
+        // Sweep left: perm[i] jumps over perm[j..i-1]
+        long long acc = 0;
+        for (int j = i - 1; j >= 0; j--) {
+            acc += g[j];
+            if (2 * acc > best_delta) {
+                best_delta = 2 * acc;
+                best_pos = j;
+                if (first) break;
             }
+        }
 
-            if (delta > best_delta) {
-                best_delta = delta;
+        // Sweep right: perm[i] jumps over perm[i+1..j]
+        acc = 0;
+        for (int j = i + 1; j < n && !(first && best_delta > 0); j++) {
+            acc += g[j];
+            if (-2 * acc > best_delta) {
+                best_delta = -2 * acc;
                 best_pos = j;
+                if (first) break;
             }
         }
 
-        // If moving improves the score, perform the best move
-        if (best_delta > 0.0) {
+        // If moving improves the score, perform the move
+        if (best_delta > 0) {
             int temp = perm[i];
 
             // Shift elements to make space for insertion
@@ -105,6 +105,8 @@ static void move_insert(RanksFile *rf, int *perm, double *lastscore) {
             }
 
             *lastscore += best_delta;
+            if (best_pos < *lo || i < *lo) *lo = best_pos < i ? best_pos : i;
+            if (best_pos > *hi || i > *hi) *hi = best_pos > i ? best_pos : i;
         }
     }
 }
@@ -112,56 +114,166 @@ static void move_insert(RanksFile *rf, int *perm, double *lastscore) {
 // =====================================================
 // Local Permutation Optimization
 // -----------------------------------------------------
-// Looks at a small window of MPERM consecutive candidates
-// and tries all possible permutations of that window.
-// Keeps the best ordering that maximizes partial score.
+// Finds the best order of a window of w consecutive
+// candidates, which helps escape small local minima.
 //
-// This is a brute-force local improvement inside a small
-// subrange, which helps escape small local minima.
+// The margins among the window's candidates are copied into
+// a w x w table first. Short windows are enumerated in
+// plain-change order (Knuth's Algorithm P), where each
+// ordering differs from the previous one by an adjacent swap
+// and so is scored in O(1): swapping a directly above b
+// changes the score by -2 m(a,b). Longer windows are solved
+// exactly by dynamic programming over the subsets of the
+// window, as in kemeny_dp.c, in O(w 2^w) instead of O(w!).
+//
+// The buffers live in a Window allocated once per run.
 // =====================================================
-static void local_permute(RanksFile *rf, int *perm, double *lastscore, int lo, int hi) {
-    int len = hi - lo + 1;
-    if (len > MPERM) len = MPERM;
+typedef struct {
+    int w;                // Window length
+    int *cands;           // Candidates of the current window
+    int *L;               // L[a * w + b] = m(cands[a], cands[b])
+    int *order;           // Current / best order, as indices into cands
+    int *best;
+    int *c, *o;           // Algorithm P state
+    int *col;             // col[i << w | S] = sum of L[c][i] over c in S (DP only)
+    long long *dp;        // Best score of each subset (DP only)
+    unsigned char *last;  // Last index of that ranking (DP only)
+} Window;
+
+static int window_init(Window *win, int w) {
+    memset(win, 0, sizeof(Window));
+    win->w = w;
+    int sz = w > 0 ? w : 1;
+    win->cands = malloc(sz * sizeof(int));
+    win->L = malloc((size_t)sz * sz * sizeof(int));
+    win->order = malloc(sz * sizeof(int));
+    win->best = malloc(sz * sizeof(int));
+    win->c = malloc((sz + 1) * sizeof(int));
+    win->o = malloc((sz + 1) * sizeof(int));
+    int ok = win->cands && win->L && win->order && win->best && win->c && win->o;
+    if (w > WINDOW_ENUM_MAX) {
+        size_t nsub = (size_t)1 << w;
+        win->col = malloc((size_t)w * nsub * sizeof(int));
+        win->dp = malloc(nsub * sizeof(long long));
+        win->last = malloc(nsub);
+        ok = ok && win->col && win->dp && win->last;
+    }
+    return ok;
+}
 
-    double bestscore = compute_partial_score(rf, perm, lo, hi);
-    double oldscore = bestscore;
+static void window_free(Window *win) {
+    free(win->cands);
+    free(win->L);
+    free(win->order);
+    free(win->best);
+    free(win->c);
+    free(win->o);
+    free(win->col);
+    free(win->dp);
+    free(win->last);
+}
 
-    int *best = malloc(len * sizeof(int));
-    memcpy(best, &perm[lo], len * sizeof(int));
+// Best order by enumeration; returns its score gain
+static long long window_enumerate(Window *win) {
+    int w = win->w;
+    const int *L = win->L;
+    int *a = win->order - 1;              // Algorithm P works on a[1..w]
+    int *c = win->c, *o = win->o;
+    long long delta = 0, bestdelta = 0;
+
+    for (int i = 0; i < w; i++) win->order[i] = win->best[i] = i;
+    for (int j = 1; j <= w; j++) {
+        c[j] = 0;
+        o[j] = 1;
+    }
+    int j = w, s = 0;
+    while (j > 0) {
+        int q = c[j] + o[j];
+        if (q < 0) {
+            o[j] = -o[j];
+            j--;
+            continue;
+        }
+        if (q == j) {
+            if (j == 1) break;
+            s++;
+            o[j] = -o[j];
+            j--;
+            continue;
+        }
+        int x = j - c[j] + s, y = j - q + s;
+        int lo = x < y ? x : y;
+        delta -= 2LL * L[a[lo] * w + a[lo + 1]];
+        swap(&a[x], &a[y]);
+        c[j] = q;
+        if (delta > bestdelta) {
+            bestdelta = delta;
+            memcpy(win->best, win->order, w * sizeof(int));
+        }
+        j = w;
+        s = 0;
+    }
+    return bestdelta;
+}
 
-    int *p = malloc(len * sizeof(int));
-    memcpy(p, &perm[lo], len * sizeof(int));
+// Best order by subset DP; returns its score gain
+static long long window_dp(Window *win, long long current) {
+    int w = win->w;
+    const int *L = win->L;
+    unsigned full = (1u << w) - 1;
+
+    for (int i = 0; i < w; i++) {
+        int *t = &win->col[(size_t)i << w];
+        t[0] = 0;
+        for (unsigned S = 1; S <= full; S++)
+            t[S] = t[S & (S - 1)] + L[__builtin_ctz(S) * w + i];
+    }
 
-    int done = 0;
-    while (!done) {
-        // Compute score of current local permutation
-        double s = compute_partial_score(rf, perm, lo, hi);
-        if (s > bestscore) {
-            bestscore = s;
-            memcpy(best, &perm[lo], len * sizeof(int));
+    win->dp[0] = 0;
+    for (unsigned S = 1; S <= full; S++) {
+        long long best = 0;
+        int bestlast = -1;
+        for (unsigned rest = S; rest; rest &= rest - 1) {
+            int i = __builtin_ctz(rest);
+            unsigned T = S ^ (1u << i);
+            long long v = win->dp[T] + win->col[((size_t)i << w) | T];
+            if (bestlast < 0 || v > best) {
+                best = v;
+                bestlast = i;
+            }
         }
+        win->dp[S] = best;
+        win->last[S] = (unsigned char)bestlast;
+    }
 
-        // Generate next permutation using next_permutation logic
-        int k = len - 2;
-        while (k >= 0 && perm[lo + k] > perm[lo + k + 1]) k--;
-        if (k < 0) done = 1;
-        else {
-            int l = len - 1;
-            while (perm[lo + k] > perm[lo + l]) l--;
-            swap(&perm[lo + k], &perm[lo + l]);
-            for (int a = k + 1, b = len - 1; a < b; a++, b--)
-                swap(&perm[lo + a], &perm[lo + b]);
-        }
+    unsigned S = full;
+    for (int pos = w - 1; pos >= 0; pos--) {
+        int i = win->last[S];
+        win->best[pos] = i;
+        S ^= 1u << i;
     }
+    return win->dp[full] - current;
+}
 
-    // Apply best found local permutation if improved
-    if (bestscore > oldscore) {
-        *lastscore += (bestscore - oldscore);
-        memcpy(&perm[lo], best, len * sizeof(int));
+// Reorders perm[lo .. lo+w) optimally; returns 1 if the score improved
+static int local_permute(Window *win, const MarginMatrix *mm, int *perm, long long *lastscore, int lo) {
+    int w = win->w;
+    long long current = 0;
+
+    memcpy(win->cands, &perm[lo], w * sizeof(int));
+    for (int a = 0; a < w; a++) {
+        for (int b = 0; b < w; b++)
+            win->L[a * w + b] = margin_at(mm, win->cands[a], win->cands[b]);
+        for (int b = a + 1; b < w; b++)
+            current += win->L[a * w + b];
     }
 
-    free(best);
-    free(p);
+    long long gain = (w <= WINDOW_ENUM_MAX) ? window_enumerate(win) : window_dp(win, current);
+    if (gain <= 0) return 0;
+
+    for (int i = 0; i < w; i++) perm[lo + i] = win->cands[win->best[i]];
+    *lastscore += gain;
+    return 1;
 }
 
 // =====================================================
@@ -171,7 +283,7 @@ static void local_permute(RanksFile *rf, int *perm, double *lastscore, int lo, i
 // heuristic: candidates with fewer "losses" appear earlier.
 //
 // Specifically, for each candidate i, sum up how many others
-// prefer them over i (rf->prefmat[k][i]), then sort by this value.
+// prefer them over i (prefmat[k][i]), then sort by this value.
 // =====================================================
 static void init_ranking(RanksFile *rf, int *perm) {
     int n = rf->ncands;
@@ -181,7 +293,7 @@ static void init_ranking(RanksFile *rf, int *perm) {
         double s = 0.0;
         for (int k = 0; k < n; k++) {
             if (i == k) continue;
-            s += rf->prefmat[k][i];  // Higher means i loses more often
+            s += PREF(rf, k, i);  // Higher means i loses more often
         }
         score[i] = s;
     }
@@ -200,34 +312,64 @@ static void init_ranking(RanksFile *rf, int *perm) {
 }
 
 // =====================================================
-// Main Heuristic Kemeny Computation
+// Local Search Descent
 // -----------------------------------------------------
-// This is the main function that coordinates the heuristic:
-//   1. Start with an initial ranking (init_ranking)
-//   2. Iteratively apply move-insert and local permutation
-//   3. Stop when no further improvement is possible
+// Improves the ranking in perm until it is a local optimum:
+//   1. Iteratively apply move-insert and local permutation
+//   2. Stop when a whole pass no longer improves the score
 //
-// Outputs the final ranking and heuristic Kemeny score.
+// The window length is opts.window (at most WINDOW_MAX and
+// n). Consecutive windows overlap by about half, and a
+// window that was already optimal is skipped until some
+// position in it changes.
+//
+// Returns the Kemeny score of the final ranking, recomputed
+// from scratch, or KEMENY_NO_SCORE if out of memory. Only
+// reads rf, so threads may run descents on it concurrently
+// once ranksfile_margins(rf) has been built.
 // =====================================================
-void compute_heuristic_kemeny(RanksFile *rf, FILE *outfile) {
+long long local_search_kemeny(RanksFile *rf, int *perm) {
     int n = rf->ncands;
-    int *perm = malloc(n * sizeof(int));
-
-    // Step 1: Initialize with a simple mean-preference ranking
-    init_ranking(rf, perm);
+    const MarginMatrix *mm = ranksfile_margins(rf);
+    if (!mm) return KEMENY_NO_SCORE;
+
+    int w = rf->opts.window;
+    if (w > WINDOW_MAX) w = WINDOW_MAX;
+    if (w > n) w = n;
+    Window win;
+    int *scratch = malloc((3 * n > 0 ? 3 * n : 1) * sizeof(int));   // pos, row and g
+    if (!window_init(&win, w) || !scratch) {
+        window_free(&win);
+        free(scratch);
+        return KEMENY_NO_SCORE;
+    }
+    int *pos = scratch, *row = scratch + n, *g = scratch + 2 * n;
 
-    // Step 2: Compute initial score
-    double oldscore = compute_score(rf, perm);
+    long long oldscore = compute_score(mm, perm, pos);
 
-    // Step 3: Iteratively improve the ranking
+    int step = w > 2 ? w / 2 : 1;      // Consecutive windows overlap by about half
+    int prevlo = 0, prevhi = n - 1;   // Changed by the windows of the last pass
     for (;;) {
-        move_insert(rf, perm, &oldscore);
-
-        // Apply local optimization on small windows
-        for (int i = 0; i <= n - MPERM; i++)
-            local_permute(rf, perm, &oldscore, i, i + MPERM - 1);
+        long long score = oldscore;
+        int lo = prevlo, hi = prevhi;  // Changed since the windows last looked
+        move_insert(mm, perm, &score, rf->opts.first_improvement, &lo, &hi, row, g);
+
+        // Apply local optimization on the windows touching a change
+        prevlo = n;
+        prevhi = -1;
+        for (int i = 0, next; w >= 2 && i <= n - w; i = next) {
+            next = i + step;
+            if (i < n - w && next > n - w) next = n - w;   // Last window ends at n
+            if (i + w - 1 < lo || i > hi) continue;
+            if (local_permute(&win, mm, perm, &score, i)) {
+                if (i < lo) lo = i;
+                if (i + w - 1 > hi) hi = i + w - 1;
+                if (i < prevlo) prevlo = i;
+                prevhi = i + w - 1;
+            }
+        }
 
-        double newscore = compute_score(rf, perm);
+        long long newscore = compute_score(mm, perm, pos);
 
         // If no improvement, stop
         if (newscore <= oldscore)
@@ -235,9 +377,39 @@ void compute_heuristic_kemeny(RanksFile *rf, FILE *outfile) {
 
         oldscore = newscore;
     }
+    long long score = compute_score(mm, perm, pos);
+    window_free(&win);
+    free(scratch);
+
+    return score;
+}
+
+// =====================================================
+// Main Heuristic Kemeny Computation
+// -----------------------------------------------------
+// One descent from the mean-preference ranking. Fills perm
+// with the final ranking and returns its Kemeny score.
+// =====================================================
+long long heuristic_kemeny_solve(RanksFile *rf, int *perm) {
+    init_ranking(rf, perm);
+    return local_search_kemeny(rf, perm);
+}
+
+// =====================================================
+// Outputs the heuristic ranking and its Kemeny score.
+// =====================================================
+void compute_heuristic_kemeny(RanksFile *rf, FILE *outfile) {
+    int n = rf->ncands;
+    int *perm = malloc((n > 0 ? n : 1) * sizeof(int));
+
+    long long score = kemeny_solve(rf, heuristic_kemeny_solve, perm);
+    if (score == KEMENY_NO_SCORE) {
+        fprintf(outfile, "\nHeuristic Kemeny: out of memory.\n");
+        free(perm);
+        return;
+    }
 
-    // Step 4: Output the final ranking
-    fprintf(outfile, "\nHeuristic Kemeny ranking (score = %.0f): ", oldscore / 2.0);
+    fprintf(outfile, "\nHeuristic Kemeny ranking (score = %lld): ", score);
     for (int i = 0; i < n; i++) {
         fprintf(outfile, "%s ", rf->unnames[perm[i]]);
     }
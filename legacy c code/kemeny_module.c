@@ -0,0 +1,405 @@
+// kemeny_module.c
+#define PY_SSIZE_T_CLEAN
+#include <Python.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "ranksfile.h"
+
+//----------------------------------------------------------
+// Python bindings (module _kemeny)
+//----------------------------------------------------------
+// Built with setup.py next to this file, which compiles the
+// whole solver library (LIBRARY_SOURCES there) into the
+// extension. For C callers the same sources make a plain
+// shared library:
+//
+//   gcc -O3 -shared -fPIC -pthread <LIBRARY_SOURCES> -o libkemeny.so -lm
+//
+// Election(ranks, **options) builds the preference matrix
+// from a voters x candidates array of rank positions
+// (ranks[v, c] = place of candidate c on ballot v, lower is
+// better, as given by soc_loader.load_soc_strict_orders).
+// Rows need not be permutations of 0..n-1: equal positions
+// are ties (see ranksfile_from_positions). The array is taken
+// through the buffer protocol and read in place through its
+// strides, so NumPy arrays of any integer width and layout
+// are not copied; NumPy itself is not needed to build.
+//
+// election.solve(method) runs one method by its name in the
+// method table (see methods.c) and returns (order, score):
+// the candidate indices best first, as a read-only buffer of
+// C ints (numpy.frombuffer wraps it without a copy), and the
+// Kemeny score as the sum of margins over ordered pairs.
+// Margins, tournament and components are built once per
+// Election and shared by its solves. The GIL is released
+// while the matrix is built and while a method runs; each
+// Election has a lock, so solves of one Election from
+// several Python threads take turns.
+//
+// solve(method, ranks, **options) is the one-shot form, and
+// methods() lists the method names.
+//
+// Options (keywords): threads, node_limit, decompose, window,
+// restarts, seed, time_limit_ms, kwiksort_reps,
+// first_improvement; unset ones keep the library defaults.
+//----------------------------------------------------------
+
+typedef struct {
+    PyObject_HEAD
+    RanksFile *rf;
+    PyThread_type_lock lock;  // Held while a method runs on rf
+} ElectionObject;
+
+static PyTypeObject ElectionType;
+
+// Order buffer returned by solve: a read-only 1-D buffer of ints
+typedef struct {
+    PyObject_HEAD
+    int *data;
+    Py_ssize_t n;
+    Py_ssize_t shape[1];
+    Py_ssize_t strides[1];
+} OrderObject;
+
+static PyTypeObject OrderType;
+
+//----------------------------------------------------------
+// Options
+//----------------------------------------------------------
+
+static char *option_keywords[] = {
+    "threads", "node_limit", "decompose", "window", "restarts", "seed",
+    "time_limit_ms", "kwiksort_reps", "first_improvement", NULL
+};
+
+// Fills opts from the defaults and the keyword arguments; 0 on error
+static int parse_options(PyObject *kwargs, KemenyOptions *opts) {
+    *opts = kemeny_default_options;
+    if (!kwargs) return 1;
+
+    PyObject *key, *value;
+    Py_ssize_t pos = 0;
+    while (PyDict_Next(kwargs, &pos, &key, &value)) {
+        const char *k = PyUnicode_AsUTF8(key);
+        if (!k) return 0;
+        int i = 0;
+        while (option_keywords[i] && strcmp(option_keywords[i], k) != 0) i++;
+        if (!option_keywords[i]) {
+            PyErr_Format(PyExc_TypeError, "unknown option '%s'", k);
+            return 0;
+        }
+        unsigned long long u = 0;
+        long long v = 0;
+        if (i == 5) u = PyLong_AsUnsignedLongLongMask(value);
+        else v = PyLong_AsLongLong(value);
+        if (PyErr_Occurred()) return 0;
+        switch (i) {
+        case 0: opts->nthreads = (int)v; break;
+        case 1: opts->node_limit = v; break;
+        case 2: opts->decompose = v != 0; break;
+        case 3: opts->window = (int)v; break;
+        case 4: opts->restarts = (int)v; break;
+        case 5: opts->seed = u; break;
+        case 6: opts->time_limit_ms = v; break;
+        case 7: opts->kwiksort_reps = (int)v; break;
+        case 8: opts->first_improvement = v != 0; break;
+        }
+    }
+    return 1;
+}
+
+//----------------------------------------------------------
+// Matrix construction from a buffer
+//----------------------------------------------------------
+
+static RanksFile *election_build(PyObject *ranks, const KemenyOptions *opts) {
+    Py_buffer view;
+    if (PyObject_GetBuffer(ranks, &view, PyBUF_RECORDS_RO) < 0) return NULL;
+
+    const char *fmt = view.format ? view.format : "B";
+    if (*fmt == '@' || *fmt == '=' || *fmt == '<') fmt++;
+    int integral = fmt[0] && !fmt[1] && strchr("bBhHiIlLqQnN", fmt[0]);
+    if (view.ndim != 2 || !integral || !(view.itemsize == 1 || view.itemsize == 2 ||
+                                         view.itemsize == 4 || view.itemsize == 8)) {
+        PyErr_SetString(PyExc_TypeError, "ranks must be a 2-D array of integers (voters x candidates)");
+        PyBuffer_Release(&view);
+        return NULL;
+    }
+    if (view.shape[0] > INT_MAX || view.shape[1] > INT_MAX) {
+        PyErr_SetString(PyExc_ValueError, "ranks is too large");
+        PyBuffer_Release(&view);
+        return NULL;
+    }
+
+    RanksFile *rf;
+    Py_BEGIN_ALLOW_THREADS
+    rf = ranksfile_from_positions(view.buf, (int)view.itemsize, view.strides[0], view.strides[1],
+                                  (int)view.shape[0], (int)view.shape[1], opts);
+    Py_END_ALLOW_THREADS
+    PyBuffer_Release(&view);
+
+    if (!rf) PyErr_NoMemory();
+    return rf;
+}
+
+//----------------------------------------------------------
+// Solving
+//----------------------------------------------------------
+
+static PyObject *order_new(int *data, int n) {
+    OrderObject *o = PyObject_New(OrderObject, &OrderType);
+    if (!o) {
+        free(data);
+        return NULL;
+    }
+    o->data = data;
+    o->n = n;
+    o->shape[0] = n;
+    o->strides[0] = sizeof(int);
+    return (PyObject *)o;
+}
+
+// Runs method name on rf; lock (may be NULL) is taken without the GIL
+static PyObject *election_run(RanksFile *rf, PyThread_type_lock lock, const char *name) {
+    const KemenyMethod *m = kemeny_find_method(name, strlen(name));
+    if (!m) {
+        PyErr_Format(PyExc_ValueError, "unknown method '%s'", name);
+        return NULL;
+    }
+
+    int n = rf->ncands;
+    int *perm = malloc((n > 0 ? n : 1) * sizeof(int));
+    if (!perm) return PyErr_NoMemory();
+
+    long long score;
+    Py_BEGIN_ALLOW_THREADS
+    if (lock) PyThread_acquire_lock(lock, WAIT_LOCK);
+    score = kemeny_method_solve(rf, m, perm);
+    if (lock) PyThread_release_lock(lock);
+    Py_END_ALLOW_THREADS
+
+    if (score == KEMENY_NO_SCORE) {
+        free(perm);
+        PyErr_Format(PyExc_RuntimeError, "method '%s' found no ranking (too many candidates or out of memory)",
+                     name);
+        return NULL;
+    }
+    PyObject *order = order_new(perm, n);
+    if (!order) return NULL;
+    return Py_BuildValue("(NL)", order, score);
+}
+
+//----------------------------------------------------------
+// Election type
+//----------------------------------------------------------
+
+static PyObject *Election_new(PyTypeObject *type, PyObject *args, PyObject *kwargs) {
+    PyObject *ranks;
+    KemenyOptions opts;
+    if (!PyArg_ParseTuple(args, "O:Election", &ranks)) return NULL;
+    if (!parse_options(kwargs, &opts)) return NULL;
+
+    RanksFile *rf = election_build(ranks, &opts);
+    if (!rf) return NULL;
+    ElectionObject *self = (ElectionObject *)type->tp_alloc(type, 0);
+    if (!self) {
+        ranksfile_destroy(rf);
+        return NULL;
+    }
+    self->rf = rf;
+    self->lock = PyThread_allocate_lock();
+    if (!self->lock) {
+        Py_DECREF(self);
+        return PyErr_NoMemory();
+    }
+    return (PyObject *)self;
+}
+
+static void Election_dealloc(ElectionObject *self) {
+    if (self->lock) PyThread_free_lock(self->lock);
+    ranksfile_destroy(self->rf);
+    Py_TYPE(self)->tp_free((PyObject *)self);
+}
+
+static PyObject *Election_solve(ElectionObject *self, PyObject *args) {
+    const char *name;
+    if (!PyArg_ParseTuple(args, "s:solve", &name)) return NULL;
+    return election_run(self->rf, self->lock, name);
+}
+
+static PyObject *Election_margin(ElectionObject *self, PyObject *args) {
+    int a, b;
+    if (!PyArg_ParseTuple(args, "ii:margin", &a, &b)) return NULL;
+    if (a < 0 || b < 0 || a >= self->rf->ncands || b >= self->rf->ncands) {
+        PyErr_SetString(PyExc_IndexError, "candidate index out of range");
+        return NULL;
+    }
+    return PyLong_FromLong(PREF(self->rf, a, b));
+}
+
+static PyObject *Election_get_ncands(ElectionObject *self, void *closure) {
+    return PyLong_FromLong(self->rf->ncands);
+}
+
+static PyObject *Election_get_nvoters(ElectionObject *self, void *closure) {
+    return PyLong_FromLong(self->rf->nballots);
+}
+
+static PyObject *Election_get_nodes(ElectionObject *self, void *closure) {
+    return PyLong_FromLongLong(self->rf->stats.nodes);
+}
+
+static PyObject *Election_get_gap(ElectionObject *self, void *closure) {
+    return PyLong_FromLongLong(self->rf->stats.gap);
+}
+
+static PyMethodDef Election_methods[] = {
+    { "solve", (PyCFunction)Election_solve, METH_VARARGS,
+      "solve(method) -> (order, score): ranking of one method, best first, and its Kemeny score" },
+    { "margin", (PyCFunction)Election_margin, METH_VARARGS,
+      "margin(a, b) -> voters preferring a to b minus those preferring b to a" },
+    { NULL, NULL, 0, NULL }
+};
+
+static PyGetSetDef Election_getset[] = {
+    { "ncands", (getter)Election_get_ncands, NULL, "number of candidates", NULL },
+    { "nvoters", (getter)Election_get_nvoters, NULL, "number of ballots", NULL },
+    { "nodes", (getter)Election_get_nodes, NULL, "nodes or moves explored by the last solve", NULL },
+    { "gap", (getter)Election_get_gap, NULL, "optimality gap left by the last solve (0 = optimal)", NULL },
+    { NULL, NULL, NULL, NULL, NULL }
+};
+
+static PyTypeObject ElectionType = {
+    PyVarObject_HEAD_INIT(NULL, 0)
+    .tp_name = "_kemeny.Election",
+    .tp_basicsize = sizeof(ElectionObject),
+    .tp_dealloc = (destructor)Election_dealloc,
+    .tp_flags = Py_TPFLAGS_DEFAULT,
+    .tp_doc = "Election(ranks, **options): preference matrix of a voters x candidates position array",
+    .tp_methods = Election_methods,
+    .tp_getset = Election_getset,
+    .tp_new = Election_new,
+};
+
+//----------------------------------------------------------
+// Order type: a read-only int buffer
+//----------------------------------------------------------
+
+static int Order_getbuffer(OrderObject *self, Py_buffer *view, int flags) {
+    if (flags & PyBUF_WRITABLE) {
+        PyErr_SetString(PyExc_BufferError, "order is read-only");
+        view->obj = NULL;
+        return -1;
+    }
+    view->obj = (PyObject *)self;
+    Py_INCREF(self);
+    view->buf = self->data;
+    view->len = self->n * (Py_ssize_t)sizeof(int);
+    view->readonly = 1;
+    view->itemsize = sizeof(int);
+    view->format = (flags & PyBUF_FORMAT) ? "i" : NULL;
+    view->ndim = 1;
+    view->shape = (flags & PyBUF_ND) ? self->shape : NULL;
+    view->strides = (flags & PyBUF_STRIDES) ? self->strides : NULL;
+    view->suboffsets = NULL;
+    view->internal = NULL;
+    return 0;
+}
+
+static PyBufferProcs Order_as_buffer = {
+    .bf_getbuffer = (getbufferproc)Order_getbuffer,
+};
+
+static Py_ssize_t Order_length(OrderObject *self) {
+    return self->n;
+}
+
+static PyObject *Order_item(OrderObject *self, Py_ssize_t i) {
+    if (i < 0 || i >= self->n) {
+        PyErr_SetString(PyExc_IndexError, "order index out of range");
+        return NULL;
+    }
+    return PyLong_FromLong(self->data[i]);
+}
+
+static PySequenceMethods Order_as_sequence = {
+    .sq_length = (lenfunc)Order_length,
+    .sq_item = (ssizeargfunc)Order_item,
+};
+
+static void Order_dealloc(OrderObject *self) {
+    free(self->data);
+    PyObject_Free(self);
+}
+
+static PyTypeObject OrderType = {
+    PyVarObject_HEAD_INIT(NULL, 0)
+    .tp_name = "_kemeny.Order",
+    .tp_basicsize = sizeof(OrderObject),
+    .tp_dealloc = (destructor)Order_dealloc,
+    .tp_as_sequence = &Order_as_sequence,
+    .tp_as_buffer = &Order_as_buffer,
+    .tp_flags = Py_TPFLAGS_DEFAULT,
+    .tp_doc = "Candidate indices, best first (supports the buffer protocol)",
+};
+
+//----------------------------------------------------------
+// Module functions
+//----------------------------------------------------------
+
+static PyObject *module_solve(PyObject *module, PyObject *args, PyObject *kwargs) {
+    const char *name;
+    PyObject *ranks;
+    KemenyOptions opts;
+    if (!PyArg_ParseTuple(args, "sO:solve", &name, &ranks)) return NULL;
+    if (!parse_options(kwargs, &opts)) return NULL;
+
+    RanksFile *rf = election_build(ranks, &opts);
+    if (!rf) return NULL;
+    PyObject *result = election_run(rf, NULL, name);
+    ranksfile_destroy(rf);
+    return result;
+}
+
+static PyObject *module_methods(PyObject *module, PyObject *noargs) {
+    PyObject *list = PyList_New(kemeny_nmethods);
+    if (!list) return NULL;
+    for (int m = 0; m < kemeny_nmethods; m++) {
+        PyObject *name = PyUnicode_FromString(kemeny_methods[m].name);
+        if (!name) {
+            Py_DECREF(list);
+            return NULL;
+        }
+        PyList_SET_ITEM(list, m, name);
+    }
+    return list;
+}
+
+static PyMethodDef module_functions[] = {
+    { "solve", (PyCFunction)(void (*)(void))module_solve, METH_VARARGS | METH_KEYWORDS,
+      "solve(method, ranks, **options) -> (order, score)" },
+    { "methods", module_methods, METH_NOARGS, "methods() -> list of method names" },
+    { NULL, NULL, 0, NULL }
+};
+
+static struct PyModuleDef kemeny_module = {
+    PyModuleDef_HEAD_INIT,
+    .m_name = "_kemeny",
+    .m_doc = "Native Kemeny consensus and voting-rule solvers",
+    .m_size = -1,
+    .m_methods = module_functions,
+};
+
+PyMODINIT_FUNC PyInit__kemeny(void) {
+    if (PyType_Ready(&ElectionType) < 0 || PyType_Ready(&OrderType) < 0) return NULL;
+    PyObject *m = PyModule_Create(&kemeny_module);
+    if (!m) return NULL;
+    Py_INCREF(&ElectionType);
+    if (PyModule_AddObject(m, "Election", (PyObject *)&ElectionType) < 0) {
+        Py_DECREF(&ElectionType);
+        Py_DECREF(m);
+        return NULL;
+    }
+    return m;
+}
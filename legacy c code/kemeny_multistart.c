@@ -0,0 +1,191 @@
+// kemeny_multistart.c
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "ranksfile.h"
+
+//-----------------------------------------------------
+// Multi-start local search
+//-----------------------------------------------------
+// Runs opts.restarts independent descents (local_search_
+// kemeny) from diversified starting rankings:
+//
+//   restart 0    mean preference, i.e. the single heuristic
+//   restart 1    Copeland order
+//   restart 2    Schulze order, computed once up front
+//   r % 4 == 2   a uniformly random ranking (r > 2)
+//   otherwise    a kick of the incumbent, the best ranking
+//                any worker has found so far: n/8 random
+//                candidates moved to random positions
+//
+// The restarts run in rounds of T, one per worker: restart
+// r is in round r / T on worker r mod T. The end of a round
+// is the sync point where the workers' rankings are merged
+// into the incumbent (the earliest restart on ties), and
+// the next round kicks from it. Each worker has its own
+// PRNG seeded from opts.seed and its index, so a run is
+// reproducible for a given seed and thread count.
+//
+// No ranking scores more than the sum of |m| over all
+// pairs, so once the incumbent reaches that bound no later
+// descent can beat it and the remaining rounds are skipped.
+// With opts.time_limit_ms set, no new descent starts once
+// the budget is spent (restart 0 always runs).
+//-----------------------------------------------------
+
+typedef struct {
+    RanksFile *rf;
+    int restart;                // Restart to run this round, -1 = none
+    double deadline;            // monotonic_ms() at which to stop, 0 = none
+    uint64_t rng;               // Private PRNG state, kept across rounds
+    const int *schulze;         // Schulze ranking (NULL if not computed)
+    const int *incumbent;       // Best ranking of the earlier rounds (NULL if none)
+    int *perm;                  // Ranking this restart found
+    long long score;            // Its score, KEMENY_NO_SCORE if it did not run
+} MultiTask;
+
+// Copeland order: two points per majority win, one per tie
+static void copeland_start(const Tournament *tour, int *perm) {
+    int n = tour->n;
+    KeyedCand *kc = malloc((n > 0 ? n : 1) * sizeof(KeyedCand));
+    if (!kc) {
+        for (int i = 0; i < n; i++) perm[i] = i;
+        return;
+    }
+    for (int i = 0; i < n; i++) kc[i] = (KeyedCand){ tour->copeland2[i], i };
+    sort_keyed_desc(kc, n);
+    for (int i = 0; i < n; i++) perm[i] = kc[i].cand;
+    free(kc);
+}
+
+// Uniformly random ranking (Fisher-Yates)
+static void random_start(uint64_t *rng, int *perm, int n) {
+    for (int i = 0; i < n; i++) perm[i] = i;
+    for (int i = n - 1; i > 0; i--) {
+        int j = rng_below(rng, i + 1);
+        int t = perm[i];
+        perm[i] = perm[j];
+        perm[j] = t;
+    }
+}
+
+// Copy of from with n/8 (at least 2) random reinsertions
+static void kick_start(uint64_t *rng, const int *from, int *perm, int n) {
+    memcpy(perm, from, n * sizeof(int));
+    if (n < 2) return;
+    int moves = n / 8 > 2 ? n / 8 : 2;
+    for (int k = 0; k < moves; k++) {
+        int i = rng_below(rng, n), j = rng_below(rng, n);
+        int c = perm[i];
+        if (j < i) memmove(&perm[j + 1], &perm[j], (i - j) * sizeof(int));
+        else memmove(&perm[i], &perm[i + 1], (j - i) * sizeof(int));
+        perm[j] = c;
+    }
+}
+
+// Runs one restart from its starting ranking
+static void *multistart_worker(void *arg) {
+    MultiTask *t = arg;
+    RanksFile *rf = t->rf;
+    int n = rf->ncands;
+    int r = t->restart;
+    int *perm = t->perm;
+
+    t->score = KEMENY_NO_SCORE;
+    if (r < 0 || (r != 0 && t->deadline > 0 && monotonic_ms() >= t->deadline)) return NULL;
+
+    if (r == 0) {
+        t->score = heuristic_kemeny_solve(rf, perm);
+    } else {
+        if (r == 1) copeland_start(rf->tournament, perm);
+        else if (r == 2 && t->schulze) memcpy(perm, t->schulze, n * sizeof(int));
+        else if (r % 4 == 2 || !t->incumbent) random_start(&t->rng, perm, n);
+        else kick_start(&t->rng, t->incumbent, perm, n);
+        t->score = local_search_kemeny(rf, perm);   // KEMENY_NO_SCORE if out of memory
+    }
+    return NULL;
+}
+
+//-----------------------------------------------------
+// Fills perm with the best ranking over all restarts and
+// returns its score, or KEMENY_NO_SCORE if out of memory
+//-----------------------------------------------------
+long long multistart_kemeny_solve(RanksFile *rf, int *perm) {
+    int n = rf->ncands;
+    // Built before the threads share them
+    if (!ranksfile_margins(rf) || !ranksfile_tournament(rf)) return KEMENY_NO_SCORE;
+
+    int restarts = rf->opts.restarts > 0 ? rf->opts.restarts : 1;
+    int nworkers = ranksfile_threads(rf);
+    if (nworkers > restarts) nworkers = restarts;
+    double deadline = rf->opts.time_limit_ms > 0 ? monotonic_ms() + rf->opts.time_limit_ms : 0;
+
+    MultiTask *tasks = calloc(nworkers, sizeof(MultiTask));
+    int *perms = malloc((size_t)(nworkers + 1) * (n > 0 ? n : 1) * sizeof(int));
+    if (!tasks || !perms) {
+        free(tasks);
+        free(perms);
+        return KEMENY_NO_SCORE;
+    }
+
+    // The Schulze order uses all threads itself, so it is found before the workers start
+    int *schulze = &perms[(size_t)nworkers * (n > 0 ? n : 1)];
+    if (restarts <= 2 || schulze_solve(rf, schulze) == KEMENY_NO_SCORE) schulze = NULL;
+    for (int w = 0; w < nworkers; w++) {
+        uint64_t seed = rf->opts.seed ^ (0xD1B54A32D192ED03ULL * (uint64_t)(w + 1));
+        tasks[w] = (MultiTask){ rf, -1, deadline, seed, schulze, NULL,
+                                &perms[(size_t)w * (n > 0 ? n : 1)], KEMENY_NO_SCORE };
+    }
+
+    // Score no ranking can exceed: every pair on its majority side
+    long long bound = 0;
+    for (int a = 0; a < n; a++)
+        for (int b = a + 1; b < n; b++)
+            bound += llabs((long long)PREF(rf, a, b));
+
+    long long score = KEMENY_NO_SCORE;
+    for (int first = 0; first < restarts && score < bound; first += nworkers) {
+        if (first > 0 && deadline > 0 && monotonic_ms() >= deadline) break;
+        int nt = restarts - first < nworkers ? restarts - first : nworkers;
+        for (int w = 0; w < nt; w++) {
+            tasks[w].restart = first + w;
+            tasks[w].incumbent = (score == KEMENY_NO_SCORE) ? NULL : perm;
+        }
+        run_parallel(multistart_worker, tasks, sizeof(MultiTask), nt);
+
+        // Sync point: merge the round into the incumbent
+        for (int w = 0; w < nt; w++) {
+            if (tasks[w].score > score) {
+                score = tasks[w].score;
+                memcpy(perm, tasks[w].perm, n * sizeof(int));
+            }
+        }
+    }
+    free(tasks);
+    free(perms);
+    return score;
+}
+
+//-----------------------------------------------------
+// Outputs the multi-start ranking and its Kemeny score
+//-----------------------------------------------------
+void compute_multistart_kemeny(RanksFile *rf, FILE *outfile) {
+    int n = rf->ncands;
+    int *perm = malloc((n > 0 ? n : 1) * sizeof(int));
+
+    long long score = kemeny_solve(rf, multistart_kemeny_solve, perm);
+    if (score == KEMENY_NO_SCORE) {
+        fprintf(outfile, "\nMulti-start Kemeny: out of memory.\n");
+        free(perm);
+        return;
+    }
+
+    fprintf(outfile, "\nMulti-start Kemeny ranking (score = %lld, %d restarts): ",
+            score, rf->opts.restarts > 0 ? rf->opts.restarts : 1);
+    for (int i = 0; i < n; i++) {
+        fprintf(outfile, "%s ", rf->unnames[perm[i]]);
+    }
+    fprintf(outfile, "\n");
+
+    free(perm);
+}
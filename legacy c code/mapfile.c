@@ -0,0 +1,95 @@
+// mapfile.c
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "ranksfile.h"
+
+#ifndef _WIN32
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#endif
+
+//----------------------------------------------------------
+// Memory-mapped input
+//----------------------------------------------------------
+// Ballot files are mapped read-only and scanned in place, so
+// parsing makes no per-line copies. Inputs that cannot be
+// mapped (pipes, empty files, Windows) are read into one heap
+// buffer instead; callers see the same [data, data+len) view
+// either way.
+//----------------------------------------------------------
+
+// Reads everything from f into a heap buffer
+static int read_all(FILE *f, MappedFile *mf) {
+    size_t cap = 1 << 16, n = 0, got;
+    char *buf = malloc(cap);
+    if (!buf) return 0;
+    while ((got = fread(buf + n, 1, cap - n, f)) > 0) {
+        n += got;
+        if (n == cap) {
+            char *bigger = realloc(buf, cap * 2);
+            if (!bigger) { free(buf); return 0; }
+            buf = bigger;
+            cap *= 2;
+        }
+    }
+    mf->data = buf;
+    mf->len = n;
+    mf->mapped = 0;
+    return 1;
+}
+
+//----------------------------------------------------------
+// Function: map_file
+//----------------------------------------------------------
+// Maps path (or stdin if path is NULL) into memory.
+// Returns 1 on success, 0 if the input cannot be read.
+//----------------------------------------------------------
+int map_file(const char *path, MappedFile *mf) {
+    memset(mf, 0, sizeof(MappedFile));
+
+#ifndef _WIN32
+    int fd = path ? open(path, O_RDONLY) : STDIN_FILENO;
+    if (fd < 0) return 0;
+
+    struct stat st;
+    if (fstat(fd, &st) == 0 && S_ISREG(st.st_mode) && st.st_size > 0) {
+        void *p = mmap(NULL, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+        if (p != MAP_FAILED) {
+#ifdef MADV_SEQUENTIAL
+            madvise(p, st.st_size, MADV_SEQUENTIAL);   // Read-ahead aggressively
+#endif
+            if (path) close(fd);
+            mf->data = p;
+            mf->len = st.st_size;
+            mf->mapped = 1;
+            return 1;
+        }
+    }
+    if (path) close(fd);
+#endif
+
+    // Fall back to reading the whole input
+    FILE *f = path ? fopen(path, "rb") : stdin;
+    if (!f) return 0;
+    int ok = read_all(f, mf);
+    if (path) fclose(f);
+    return ok;
+}
+
+//----------------------------------------------------------
+// Function: unmap_file
+//----------------------------------------------------------
+void unmap_file(MappedFile *mf) {
+#ifndef _WIN32
+    if (mf->mapped) {
+        munmap((void *)mf->data, mf->len);
+        memset(mf, 0, sizeof(MappedFile));
+        return;
+    }
+#endif
+    free((void *)mf->data);
+    memset(mf, 0, sizeof(MappedFile));
+}
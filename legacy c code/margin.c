@@ -0,0 +1,167 @@
+// margin.c
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include "ranksfile.h"
+
+//----------------------------------------------------------
+// Packed margin matrix
+//----------------------------------------------------------
+// prefmat is skew-symmetric (prefmat[b][a] == -prefmat[a][b]),
+// so half of it is redundant. The margin matrix stores each
+// pair once: the strict upper triangle, row by row, where row
+// a holds m(a,b) for b = a+1 .. n-1 contiguously. Entries are
+// int16 when no margin can exceed 32767 in magnitude (that
+// is, at most 32767 voters) and int32 otherwise, so the hot
+// loops read a half or a quarter of the bytes.
+//
+// The kernels below are plain loops over contiguous arrays
+// with no branches in the body, written so the compiler can
+// vectorize them (build with -O3, ideally -march=native).
+//----------------------------------------------------------
+
+// Offset of row a in the packed triangle
+static inline size_t row_offset(int n, int a) {
+    return (size_t)a * (2 * (size_t)n - a - 1) / 2;
+}
+
+//----------------------------------------------------------
+// Function: margin_create
+//----------------------------------------------------------
+// Builds the packed margin matrix of rf. Returns NULL if
+// memory cannot be allocated.
+//----------------------------------------------------------
+MarginMatrix *margin_create(const RanksFile *rf) {
+    int n = rf->ncands;
+    MarginMatrix *mm = calloc(1, sizeof(MarginMatrix));
+    if (!mm) return NULL;
+
+    mm->n = n;
+    mm->width = (rf->nrankers <= INT16_MAX) ? 2 : 4;
+    size_t npairs = (size_t)n * (n > 0 ? n - 1 : 0) / 2;
+    mm->tri = malloc((npairs > 0 ? npairs : 1) * mm->width);
+    if (!mm->tri) {
+        free(mm);
+        return NULL;
+    }
+
+    for (int a = 0; a < n; a++) {
+        size_t off = row_offset(n, a);
+        const int *row = &PREF(rf, a, 0);
+        if (mm->width == 2) {
+            int16_t *t = (int16_t *)mm->tri + off;
+            for (int b = a + 1; b < n; b++) t[b - a - 1] = (int16_t)row[b];
+        } else {
+            int32_t *t = (int32_t *)mm->tri + off;
+            for (int b = a + 1; b < n; b++) t[b - a - 1] = row[b];
+        }
+    }
+    return mm;
+}
+
+//----------------------------------------------------------
+// Function: margin_update
+//----------------------------------------------------------
+// Copies m(a,b) from prefmat again for every pair of the k
+// candidates cands[], after a ballot on them was added (see
+// ranksfile_update). Returns 0 if the entries are int16 and
+// rf now has too many voters for them, or if they are read
+// from a cache file, in which case the matrix has to be
+// rebuilt.
+//----------------------------------------------------------
+int margin_update(MarginMatrix *mm, const RanksFile *rf, const int *cands, int k) {
+    if (mm->borrowed) return 0;
+    if (mm->width == 2 && rf->nrankers > INT16_MAX) return 0;
+    for (int i = 0; i < k; i++) {
+        for (int j = 0; j < k; j++) {
+            int a = cands[i], b = cands[j];
+            if (a >= b) continue;
+            size_t off = row_offset(mm->n, a) + (b - a - 1);
+            if (mm->width == 2) ((int16_t *)mm->tri)[off] = (int16_t)PREF(rf, a, b);
+            else ((int32_t *)mm->tri)[off] = PREF(rf, a, b);
+        }
+    }
+    return 1;
+}
+
+void margin_destroy(MarginMatrix *mm) {
+    if (!mm) return;
+    if (!mm->borrowed) free(mm->tri);
+    free(mm);
+}
+
+//----------------------------------------------------------
+// Function: margin_at
+//----------------------------------------------------------
+// m(a,b): voters preferring a over b minus those preferring
+// b over a.
+//----------------------------------------------------------
+int margin_at(const MarginMatrix *mm, int a, int b) {
+    if (a == b) return 0;
+    int sign = 1;
+    if (a > b) {
+        int t = a; a = b; b = t;
+        sign = -1;
+    }
+    size_t k = row_offset(mm->n, a) + (b - a - 1);
+    int v = (mm->width == 2) ? ((const int16_t *)mm->tri)[k] : ((const int32_t *)mm->tri)[k];
+    return sign * v;
+}
+
+//----------------------------------------------------------
+// Function: margin_row
+//----------------------------------------------------------
+// Expands row c into out[x] = m(c,x) for all x. The part
+// right of the diagonal is copied from the packed row, the
+// part left of it is read down column c.
+//----------------------------------------------------------
+#define MARGIN_ROW(T)                                              \
+    do {                                                           \
+        const T *tri = (const T *)mm->tri;                         \
+        for (int x = 0; x < c; x++)                                \
+            out[x] = -tri[row_offset(n, x) + (c - x - 1)];         \
+        out[c] = 0;                                                \
+        const T *r = tri + row_offset(n, c);                       \
+        for (int x = c + 1; x < n; x++)                            \
+            out[x] = r[x - c - 1];                                 \
+    } while (0)
+
+void margin_row(const MarginMatrix *mm, int c, int *out) {
+    int n = mm->n;
+    if (mm->width == 2) MARGIN_ROW(int16_t);
+    else MARGIN_ROW(int32_t);
+}
+
+//----------------------------------------------------------
+// Function: margin_score
+//----------------------------------------------------------
+// Kemeny score of the ranking whose positions are pos[c]
+// (0 = best): the sum of m(a,b) over pairs with a ranked
+// above b, minus m(a,b) over pairs with b above a. The
+// packed rows are walked in storage order, with a branch-free
+// select on the position comparison.
+//----------------------------------------------------------
+#define MARGIN_SCORE(T)                                            \
+    do {                                                           \
+        const T *tri = (const T *)mm->tri;                         \
+        for (int a = 0; a < n - 1; a++) {                          \
+            const T *r = tri + row_offset(n, a);                   \
+            const int *pb = pos + a + 1;                           \
+            int pa = pos[a], len = n - a - 1;                      \
+            long long acc = 0;                                     \
+            for (int k = 0; k < len; k++) {                        \
+                int v = r[k];                                      \
+                acc += (pb[k] > pa) ? v : -v;                      \
+            }                                                      \
+            score += acc;                                          \
+        }                                                          \
+    } while (0)
+
+long long margin_score(const MarginMatrix *mm, const int *pos) {
+    int n = mm->n;
+    long long score = 0;
+    if (mm->width == 2) MARGIN_SCORE(int16_t);
+    else MARGIN_SCORE(int32_t);
+    return score;
+}
@@ -0,0 +1,111 @@
+// merge.c
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "ranksfile.h"
+
+//----------------------------------------------------------
+// Partial aggregates
+//----------------------------------------------------------
+// The preference matrix is a sum over ballots, so ballots can
+// be counted in shards -- split files, separate processes or
+// separate machines -- and the shard matrices added later.
+// A shard's aggregate is an election cache (see cache.c):
+// its candidate names, counts and margins, O(n^2) numbers
+// however many ballots went into it. "kemeny --emit-partial"
+// writes one, and "kemeny merge" adds any number of them up.
+//
+// Shards need not have seen the same candidates, or seen
+// them in the same order: candidates are matched by name, and
+// one a shard never saw simply has no margin against anyone
+// in it. A merged election is again a cache, so shards can be
+// merged in a tree.
+//----------------------------------------------------------
+
+//----------------------------------------------------------
+// Function: ranksfile_merge
+//----------------------------------------------------------
+// Adds the election src into dst: its candidates are looked
+// up in dst by name (new names are appended), its margins
+// added to the matching entries of dst's matrix and its
+// voter and preference counts to dst's. The number of
+// distinct ballots becomes unknown (-1): shards may share
+// orders, which the margins cannot tell. dst's cached
+// margins, tournament and components are dropped. Returns 0
+// if memory runs out, in which case dst may hold part of
+// src.
+//----------------------------------------------------------
+int ranksfile_merge(RanksFile *dst, const RanksFile *src) {
+    int k = src->ncands;
+    int *map = malloc((k > 0 ? k : 1) * sizeof(int));
+    if (!map) return 0;
+
+    // Candidate i of src is candidate map[i] of dst
+    for (int i = 0; i < k; i++) {
+        const char *name = src->unnames[i];
+        map[i] = nametable_intern(&dst->names, name, strlen(name));
+        if (map[i] < 0) {
+            free(map);
+            return 0;
+        }
+    }
+    dst->unnames = dst->names.names;
+    if (!ranksfile_grow(dst, dst->names.count)) {
+        free(map);
+        return 0;
+    }
+
+    for (int i = 0; i < k; i++) {
+        const int *row = &PREF(src, i, 0);
+        int *out = &PREF(dst, map[i], 0);
+        for (int j = 0; j < k; j++) out[map[j]] += row[j];
+    }
+    dst->nrankers += src->nrankers;
+    dst->nballots = -1;
+    dst->nprefs += src->nprefs;
+
+    // ranksfile_grow only drops the caches when it adds candidates
+    margin_destroy(dst->margins);
+    tournament_destroy(dst->tournament);
+    components_destroy(dst->components);
+    dst->margins = NULL;
+    dst->tournament = NULL;
+    dst->components = NULL;
+    free(map);
+    return 1;
+}
+
+//----------------------------------------------------------
+// Function: read_merged
+//----------------------------------------------------------
+// Reads the npaths elections (partial aggregates, or any
+// format read_election takes) one at a time and merges them
+// into a new RanksFile, so only one shard is in memory
+// besides the sum. Returns NULL if one cannot be read or
+// memory runs out. The summary line goes to outfile unless
+// it is NULL.
+//----------------------------------------------------------
+RanksFile *read_merged(const char **paths, int npaths, FILE *outfile) {
+    RanksFile *rf = ranksfile_create(0, 0);
+    if (!rf) return NULL;
+
+    for (int i = 0; i < npaths; i++) {
+        RanksFile *part = read_election(paths[i], NULL, 0);
+        if (!part) {
+            ranksfile_destroy(rf);
+            return NULL;
+        }
+        int ok = ranksfile_merge(rf, part);
+        ranksfile_destroy(part);
+        if (!ok) {
+            fprintf(stderr, "Out of memory while merging %s\n", paths[i]);
+            ranksfile_destroy(rf);
+            return NULL;
+        }
+    }
+
+    if (outfile)
+        fprintf(outfile, "*** There are %d candidates and %d voters (%d partials merged). ***\n",
+                rf->ncands, rf->nrankers, npaths);
+    return rf;
+}
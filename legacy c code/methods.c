@@ -0,0 +1,135 @@
+// methods.c
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "ranksfile.h"
+
+//----------------------------------------------------------
+// Method table
+//----------------------------------------------------------
+// Every ranking method by name, in the order "all" runs
+// them. Nothing is computed up front: the margins, the
+// tournament and the components are built by the first
+// method that needs them (ranksfile_margins,
+// ranksfile_tournament, ranksfile_components) and shared by
+// the methods after it, so a run pays only for what it
+// selects.
+//----------------------------------------------------------
+const KemenyMethod kemeny_methods[] = {
+    { "bruteforce",  compute_kemeny_bruteforce,       kemeny_bruteforce_solve, 1, "exact, all rankings (small components)" },
+    { "dp",          compute_kemeny_dp,               kemeny_dp_solve,         1, "exact, subset dynamic programming" },
+    { "bnb",         compute_kemeny_branch_bound,     kemeny_bnb_solve,        1, "exact, branch and bound" },
+    { "heuristic",   compute_heuristic_kemeny,        heuristic_kemeny_solve,  1, "local search from the mean-preference order" },
+    { "multistart",  compute_multistart_kemeny,       multistart_kemeny_solve, 1, "multi-start local search" },
+    { "anneal",      compute_anneal_kemeny,           anneal_kemeny_solve,     0, "anytime simulated annealing" },
+    { "borda",       compute_borda_heuristic,         borda_solve,             0, "Borda count" },
+    { "copeland",    compute_copeland_approximation,  copeland_solve,          0, "Copeland score" },
+    { "rankedpairs", compute_ranked_pairs,            ranked_pairs_solve,      0, "Ranked Pairs (Tideman)" },
+    { "schulze",     compute_schulze,                 schulze_solve,           0, "Schulze beatpath" },
+    { "kwiksort",    compute_quicksort_approximation, kwiksort_solve,          0, "KwikSort, best of several runs" },
+};
+const int kemeny_nmethods = sizeof(kemeny_methods) / sizeof(kemeny_methods[0]);
+
+// The "default" preset: the methods the program always ran,
+// in their old order. The others are opt-in, or all of them
+// with "all".
+static const char default_methods[] = "bruteforce,heuristic,borda,copeland,rankedpairs";
+
+//----------------------------------------------------------
+// Function: kemeny_find_method
+//----------------------------------------------------------
+// The method called name (len bytes, not necessarily
+// NUL-terminated), or NULL.
+//----------------------------------------------------------
+const KemenyMethod *kemeny_find_method(const char *name, size_t len) {
+    for (int m = 0; m < kemeny_nmethods; m++)
+        if (strlen(kemeny_methods[m].name) == len && strncmp(kemeny_methods[m].name, name, len) == 0)
+            return &kemeny_methods[m];
+    return NULL;
+}
+
+//----------------------------------------------------------
+// Function: kemeny_method_solve
+//----------------------------------------------------------
+// Runs one method for its ranking alone, the way its
+// compute_* function does: decomposed methods go through
+// kemeny_solve, the others see the whole election.
+//----------------------------------------------------------
+long long kemeny_method_solve(RanksFile *rf, const KemenyMethod *m, int *perm) {
+    if (m->decomposed) return kemeny_solve(rf, m->solve, perm);
+    memset(&rf->stats, 0, sizeof(SolveStats));
+    return m->solve(rf, perm);
+}
+
+//----------------------------------------------------------
+// Function: kemeny_select_methods
+//----------------------------------------------------------
+// Parses a comma-separated list of method names ("all" for
+// every method, "default" for the default preset) into sel,
+// which has room for max entries.
+// Returns the number selected, or -1 after naming the
+// offending entry and the known methods on stderr.
+//----------------------------------------------------------
+int kemeny_select_methods(const char *list, const KemenyMethod **sel, int max) {
+    int nsel = 0;
+    const char *p = list;
+
+    for (;;) {
+        size_t len = strcspn(p, ",");
+        if (len == 3 && strncmp(p, "all", 3) == 0) {
+            for (int m = 0; m < kemeny_nmethods && nsel < max; m++) sel[nsel++] = &kemeny_methods[m];
+        } else if (len == 7 && strncmp(p, "default", 7) == 0) {
+            nsel += kemeny_select_methods(default_methods, sel + nsel, max - nsel);
+        } else if (len > 0) {
+            const KemenyMethod *m = kemeny_find_method(p, len);
+            if (!m) {
+                fprintf(stderr, "Unknown method '%.*s'. Methods are:\n", (int)len, p);
+                for (int k = 0; k < kemeny_nmethods; k++)
+                    fprintf(stderr, "  %-12s %s\n", kemeny_methods[k].name, kemeny_methods[k].desc);
+                fprintf(stderr, "  %-12s %s\n  %-12s %s\n", "default", default_methods, "all", "every method above");
+                return -1;
+            }
+            if (nsel < max) sel[nsel++] = m;
+        }
+        if (p[len] == '\0') break;
+        p += len + 1;
+    }
+    return nsel;
+}
+
+//----------------------------------------------------------
+// Function: kemeny_run_methods
+//----------------------------------------------------------
+// Runs the selected methods on rf in order, printing to
+// outfile. The majority-graph summary is printed first when
+// one of them solves component by component and the graph
+// does split.
+//----------------------------------------------------------
+void kemeny_run_methods(RanksFile *rf, const KemenyMethod **sel, int nsel, FILE *outfile) {
+    int decomposed = 0;
+    for (int i = 0; i < nsel; i++) decomposed |= sel[i]->decomposed;
+
+    if (decomposed && rf->opts.decompose) {
+        const Components *cc = ranksfile_components(rf);
+        if (cc && cc->ncomps > 1)
+            fprintf(outfile, "*** The majority graph has %d components, the largest with %d candidates. ***\n",
+                    cc->ncomps, cc->largest);
+    }
+
+    for (int i = 0; i < nsel; i++) sel[i]->compute(rf, outfile);
+}
+
+//----------------------------------------------------------
+// Function: kemeny_run
+//----------------------------------------------------------
+// Library entry point: runs the methods named in list on
+// rf. Returns 0, or -1 if the list names an unknown method
+// (nothing is run then).
+//----------------------------------------------------------
+int kemeny_run(RanksFile *rf, const char *list, FILE *outfile) {
+    const KemenyMethod *sel[64];
+    int nsel = kemeny_select_methods(list, sel, 64);
+    if (nsel < 0) return -1;
+    kemeny_run_methods(rf, sel, nsel, outfile);
+    return 0;
+}
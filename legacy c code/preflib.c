@@ -0,0 +1,235 @@
+// preflib.c
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "ranksfile.h"
+
+//----------------------------------------------------------
+// PrefLib loader (.soc, .soi, .toc, .toi)
+//----------------------------------------------------------
+// A PrefLib file starts with "# KEY: value" metadata lines,
+// followed by one line per unique order:
+//
+//     263: 2,1,3          (263 voters cast 2 > 1 > 3)
+//     360: 5,3,{1,2,4}    (tie group in .toc / .toi files)
+//
+// Alternatives are numbered from 1. Each unique order is
+// added to the preference matrix once, weighted by its
+// multiplicity, so the cost of building the matrix depends
+// on the number of unique orders, not the number of voters.
+// The orders are collected first and added in bulk (see
+// ranksfile_add_ballots).
+// Alternatives missing from an order (.soi / .toi) are not
+// compared with anything.
+//----------------------------------------------------------
+
+int is_preflib_path(const char *path) {
+    const char *dot = strrchr(path, '.');
+    if (!dot) return 0;
+    return strcmp(dot, ".soc") == 0 || strcmp(dot, ".soi") == 0 ||
+           strcmp(dot, ".toc") == 0 || strcmp(dot, ".toi") == 0;
+}
+
+// Parses a non-negative decimal number at *p, advancing *p.
+// Returns -1 if there is no digit at *p.
+static long parse_number(const char **p, const char *end) {
+    const char *s = *p;
+    if (s >= end || *s < '0' || *s > '9') return -1;
+    long v = 0;
+    while (s < end && *s >= '0' && *s <= '9') v = v * 10 + (*s++ - '0');
+    *p = s;
+    return v;
+}
+
+static const char *skip_blanks(const char *s, const char *end) {
+    while (s < end && (*s == ' ' || *s == '\t')) s++;
+    return s;
+}
+
+// If [line, eol) starts with key, returns the position after it
+static const char *after_key(const char *line, const char *eol, const char *key) {
+    size_t klen = strlen(key);
+    if ((size_t)(eol - line) < klen || memcmp(line, key, klen) != 0) return NULL;
+    return skip_blanks(line + klen, eol);
+}
+
+// Value of a "# KEY: value" header line as a number, or -1
+static long header_number(const char *line, const char *eol, const char *key) {
+    const char *p = after_key(line, eol, key);
+    return p ? parse_number(&p, eol) : -1;
+}
+
+//----------------------------------------------------------
+// Function: read_preflib_file
+//----------------------------------------------------------
+// Returns a new RanksFile with the alternatives named as in
+// the file header and the preference matrix built from the
+// weighted unique orders, or NULL if the file cannot be
+// read or is malformed. The summary line goes to outfile
+// unless it is NULL.
+//----------------------------------------------------------
+RanksFile *read_preflib_file(const char *path, FILE *outfile) {
+    MappedFile in;
+    if (!map_file(path, &in)) {
+        fprintf(stderr, "Cannot read %s\n", path);
+        return NULL;
+    }
+
+    RanksFile *rf = NULL;
+    int nalts = -1;
+    long declared_voters = -1, declared_orders = -1;
+    int *cands = NULL, *levels = NULL;
+    char **altnames = NULL;                  // Names from the header, NULL if absent
+    BallotSet ballots;                       // Unique orders with their multiplicities
+    const char *p = in.data;
+    const char *end = in.data + in.len;
+    int lineno = 0;
+
+    ballotset_init(&ballots);
+
+    while (p < end) {
+        const char *line = p;
+        const char *eol = memchr(p, '\n', end - p);
+        if (!eol) eol = end;
+        p = eol + 1;
+        lineno++;
+
+        //--------------------------------------------------
+        // Header metadata
+        //--------------------------------------------------
+        if (line[0] == '#') {
+            long v;
+            const char *q;
+            if ((v = header_number(line, eol, "# NUMBER ALTERNATIVES:")) >= 0) {
+                nalts = (int)v;
+            } else if ((v = header_number(line, eol, "# NUMBER VOTERS:")) >= 0) {
+                declared_voters = v;
+            } else if ((v = header_number(line, eol, "# NUMBER UNIQUE ORDERS:")) >= 0) {
+                declared_orders = v;
+            } else if ((q = after_key(line, eol, "# ALTERNATIVE NAME")) != NULL) {
+                long altno = parse_number(&q, eol);
+                if (!rf || q >= eol || *q != ':') continue;   // Names before the count are ignored
+                if (altno < 1 || altno > nalts) continue;
+                const char *name = skip_blanks(q + 1, eol);
+                const char *nend = eol;
+                while (nend > name && (nend[-1] == '\r' || nend[-1] == ' ')) nend--;
+                free(altnames[altno - 1]);
+                altnames[altno - 1] = malloc(nend - name + 1);
+                if (altnames[altno - 1]) {
+                    memcpy(altnames[altno - 1], name, nend - name);
+                    altnames[altno - 1][nend - name] = '\0';
+                }
+            }
+
+            // The candidate count is known: size the RanksFile
+            if (!rf && nalts >= 0) {
+                rf = ranksfile_create(nalts, 0);
+                cands = malloc((nalts > 0 ? nalts : 1) * sizeof(int));
+                levels = malloc((nalts > 0 ? nalts : 1) * sizeof(int));
+                altnames = calloc(nalts > 0 ? nalts : 1, sizeof(char *));
+                if (!rf || !cands || !levels || !altnames) {
+                    fprintf(stderr, "Out of memory for %d candidates!\n", nalts);
+                    goto fail;
+                }
+            }
+            continue;
+        }
+
+        //--------------------------------------------------
+        // Order line: "count: a,b,{c,d},..."
+        //--------------------------------------------------
+        const char *s = skip_blanks(line, eol);
+        if (s >= eol || *s == '\r') continue;    // Blank line
+        if (!rf) {
+            fprintf(stderr, "%s:%d: order before NUMBER ALTERNATIVES header\n", path, lineno);
+            goto fail;
+        }
+
+        long count = parse_number(&s, eol);
+        s = skip_blanks(s, eol);
+        if (count < 0 || s >= eol || *s != ':') {
+            fprintf(stderr, "%s:%d: expected \"count: order\"\n", path, lineno);
+            goto fail;
+        }
+        s++;
+
+        int n = 0, level = 0, ingroup = 0;
+        while (s < eol) {
+            s = skip_blanks(s, eol);
+            if (s >= eol || *s == '\r') break;
+            if (*s == '{') { ingroup = 1; s++; continue; }
+            if (*s == '}') { ingroup = 0; level++; s++; continue; }
+            if (*s == ',') { s++; continue; }
+
+            long alt = parse_number(&s, eol);
+            if (alt < 1 || alt > nalts || n >= nalts) {
+                fprintf(stderr, "%s:%d: bad alternative in order\n", path, lineno);
+                goto fail;
+            }
+            cands[n] = (int)alt - 1;
+            levels[n] = level;
+            n++;
+            if (!ingroup) level++;
+        }
+
+        if (!ballotset_add(&ballots, cands, levels, n, (int)count)) {
+            fprintf(stderr, "Out of memory while reading %s\n", path);
+            goto fail;
+        }
+        rf->nrankers += (int)count;
+        rf->nballots++;
+    }
+
+    if (!rf) {
+        fprintf(stderr, "%s: missing NUMBER ALTERNATIVES header\n", path);
+        goto fail;
+    }
+
+    // Intern the names; missing or duplicate names fall back to
+    // the alternative number so every index keeps a unique name
+    for (int i = 0; i < rf->ncands; i++) {
+        char num[16];
+        const char *name = altnames[i];
+        if (!name || nametable_find(&rf->names, name, strlen(name)) != -1) {
+            snprintf(num, sizeof(num), "%d", i + 1);
+            name = num;
+        }
+        if (nametable_intern(&rf->names, name, strlen(name)) != i) {
+            fprintf(stderr, "%s: cannot name alternative %d\n", path, i + 1);
+            goto fail;
+        }
+    }
+    rf->unnames = rf->names.names;
+
+    if (!ranksfile_add_ballots(rf, &ballots)) {
+        fprintf(stderr, "%s: out of memory while building the preference matrix\n", path);
+        goto fail;
+    }
+
+    if (declared_voters >= 0 && declared_voters != rf->nrankers)
+        fprintf(stderr, "%s: header says %ld voters, found %d\n", path, declared_voters, rf->nrankers);
+    if (declared_orders >= 0 && declared_orders != rf->nballots)
+        fprintf(stderr, "%s: header says %ld unique orders, found %d\n", path, declared_orders, rf->nballots);
+
+    if (outfile)
+        fprintf(outfile, "*** There are %d candidates and %d voters (%d unique orders). ***\n",
+                rf->ncands, rf->nrankers, rf->nballots);
+
+    for (int i = 0; i < rf->ncands; i++) free(altnames[i]);
+    free(altnames);
+    ballotset_free(&ballots);
+    free(cands);
+    free(levels);
+    unmap_file(&in);
+    return rf;
+
+fail:
+    for (int i = 0; altnames && i < nalts; i++) free(altnames[i]);
+    free(altnames);
+    ranksfile_destroy(rf);
+    ballotset_free(&ballots);
+    free(cands);
+    free(levels);
+    unmap_file(&in);
+    return NULL;
+}
@@ -2,45 +2,206 @@
 #include <stdlib.h>
 #include <string.h>
 #include "ranksfile.h"
+#include "bitset.h"
+
+//----------------------------------------------------------
+// KwikSort (Ailon, Charikar and Newman)
+//----------------------------------------------------------
+// Quicksort on the majority tournament: a random pivot is
+// placed between the candidates that beat it by a strict
+// majority (before it) and the rest (after it, ties
+// included), and both sides are sorted the same way. One run
+// takes expected O(n log n) comparisons and is an expected
+// constant-factor approximation of the Kemeny objective.
+//
+// A partition reads only the pivot's win and tie rows: c
+// goes before the pivot exactly when the pivot neither beats
+// nor ties it. It is stable and done in place, the left side
+// compacted to the front of the segment and the right side
+// parked in a scratch buffer of the same length.
+//
+// Each call splits its PRNG into one seed per side, so a run
+// only depends on its seed, and sides of at least
+// KWIK_PARALLEL_MIN candidates may be sorted by two threads.
+// opts.kwiksort_reps runs are made, spread over the threads,
+// and the one with the best Kemeny score is kept (the lowest
+// run on ties), so the result does not depend on the number
+// of threads either.
+//----------------------------------------------------------
+
+#define KWIK_PARALLEL_MIN 4096   // Smallest side handed to another thread
+
+typedef struct {
+    const Tournament *tour;
+    int *a;               // Segment to sort
+    int *tmp;             // Scratch, as long as the segment
+    int n;
+    uint64_t rng;
+    int depth;            // Levels that may still fork a thread
+} KwikTask;
+
+static void kwiksort_rec(const Tournament *t, int *a, int *tmp, int n, uint64_t rng, int depth);
+
+static void *kwik_worker(void *arg) {
+    KwikTask *k = arg;
+    kwiksort_rec(k->tour, k->a, k->tmp, k->n, k->rng, k->depth);
+    return NULL;
+}
+
+static void kwiksort_rec(const Tournament *t, int *a, int *tmp, int n, uint64_t rng, int depth) {
+    int nw = t->nwords;
+    while (n > 1) {
+        int p = rng_below(&rng, n);
+        int pivot = a[p];
+        const uint64_t *win = &t->wins[(size_t)pivot * nw];
+        const uint64_t *tie = &t->ties[(size_t)pivot * nw];
+
+        int nl = 0, nr = 0;
+        for (int i = 0; i < n; i++) {
+            int c = a[i];
+            if (i == p) continue;
+            if (!bit_test(win, c) && !bit_test(tie, c)) a[nl++] = c;   // c beats the pivot
+            else tmp[nr++] = c;
+        }
+        a[nl] = pivot;
+        memcpy(&a[nl + 1], tmp, nr * sizeof(int));
+
+        uint64_t lseed = rng_next(&rng), rseed = rng_next(&rng);
+        int *ra = &a[nl + 1], *rt = &tmp[nl + 1];
+
+        if (depth > 0 && nl >= KWIK_PARALLEL_MIN && nr >= KWIK_PARALLEL_MIN) {
+            KwikTask sides[2] = {
+                { t, a, tmp, nl, lseed, depth - 1 },
+                { t, ra, rt, nr, rseed, depth - 1 },
+            };
+            run_parallel(kwik_worker, sides, sizeof(KwikTask), 2);
+            return;
+        }
+
+        // Recurse into the smaller side and loop on the larger,
+        // which keeps the stack O(log n)
+        if (nl < nr) {
+            kwiksort_rec(t, a, tmp, nl, lseed, depth);
+            a = ra;
+            tmp = rt;
+            n = nr;
+            rng = rseed;
+        } else {
+            kwiksort_rec(t, ra, rt, nr, rseed, depth);
+            n = nl;
+            rng = lseed;
+        }
+    }
+}
+
+//----------------------------------------------------------
+// Best-of-K repetition
+//----------------------------------------------------------
+
+typedef struct {
+    RanksFile *rf;
+    int worker;
+    int nworkers;
+    int reps;
+    int depth;            // Fork depth of each run
+    int *perm;            // Ranking of the current run
+    int *tmp;             // Its scratch
+    int *bestperm;        // Best ranking of this worker
+    long long bestscore;
+    int bestrep;          // Run that found it
+} KwikRun;
+
+static void *kwik_run_worker(void *arg) {
+    KwikRun *k = arg;
+    RanksFile *rf = k->rf;
+    int n = rf->ncands;
+
+    for (int r = k->worker; r < k->reps; r += k->nworkers) {
+        for (int i = 0; i < n; i++) k->perm[i] = i;
+        uint64_t seed = rf->opts.seed ^ (0x9E3779B97F4A7C15ULL * (uint64_t)(r + 1));
+        kwiksort_rec(rf->tournament, k->perm, k->tmp, n, seed, k->depth);
+
+        long long score = ranking_score(rf, k->perm);
+        if (score > k->bestscore) {
+            k->bestscore = score;
+            k->bestrep = r;
+            memcpy(k->bestperm, k->perm, n * sizeof(int));
+        }
+    }
+    return NULL;
+}
+
+//----------------------------------------------------------
+// Function: kwiksort_solve
+//----------------------------------------------------------
+// Fills perm with the best of opts.kwiksort_reps KwikSort
+// runs and returns its Kemeny score, or KEMENY_NO_SCORE if
+// out of memory.
+//----------------------------------------------------------
+long long kwiksort_solve(RanksFile *rf, int *perm) {
+    int n = rf->ncands;
+    int sz = n > 0 ? n : 1;
+    if (!ranksfile_tournament(rf)) return KEMENY_NO_SCORE;   // Built before the threads share it
+
+    int reps = rf->opts.kwiksort_reps > 0 ? rf->opts.kwiksort_reps : 1;
+    int nthreads = ranksfile_threads(rf);
+    int nworkers = nthreads < reps ? nthreads : reps;
+    int depth = 0;
+    while ((nworkers << (depth + 1)) <= nthreads) depth++;   // Threads left over fork inside a run
+
+    KwikRun *runs = calloc(nworkers, sizeof(KwikRun));
+    int *bufs = malloc((size_t)nworkers * 3 * sz * sizeof(int));
+    if (!runs || !bufs) {
+        free(runs);
+        free(bufs);
+        return KEMENY_NO_SCORE;
+    }
+    for (int w = 0; w < nworkers; w++) {
+        int *b = &bufs[(size_t)w * 3 * sz];
+        runs[w] = (KwikRun){ rf, w, nworkers, reps, depth, b, b + sz, b + 2 * sz, KEMENY_NO_SCORE, reps };
+    }
+    run_parallel(kwik_run_worker, runs, sizeof(KwikRun), nworkers);
+
+    const KwikRun *best = &runs[0];
+    for (int w = 1; w < nworkers; w++) {
+        if (runs[w].bestscore > best->bestscore ||
+            (runs[w].bestscore == best->bestscore && runs[w].bestrep < best->bestrep))
+            best = &runs[w];
+    }
+    long long score = best->bestscore;
+    memcpy(perm, best->bestperm, n * sizeof(int));
+
+    free(runs);
+    free(bufs);
+    return score;
+}
 
 //----------------------------------------------------------
 // Function: compute_quicksort_approximation
 //----------------------------------------------------------
-// Quicksort approximation for Kemeny:
-// 1. Use majority rule comparisons to sort candidates
-// 2. The sorted order is the consensus ranking
+// Prints the best KwikSort ranking and its Kemeny score.
 //----------------------------------------------------------
 void compute_quicksort_approximation(RanksFile *rf, FILE *outfile) {
-    fprintf(outfile, "\n=== QUICKSORT APPROXIMATION ===\n");
-    
+    fprintf(outfile, "\n=== KWIKSORT APPROXIMATION ===\n");
+
     int n = rf->ncands;
-    int indices[MAXCANDS];
-    
-    // Initialize indices array
-    for (int i = 0; i < n; i++) {
-        indices[i] = i;
+    int *indices = malloc((n > 0 ? n : 1) * sizeof(int));
+    long long score = indices ? kwiksort_solve(rf, indices) : KEMENY_NO_SCORE;
+    if (score == KEMENY_NO_SCORE) {
+        fprintf(outfile, "KwikSort: out of memory.\n");
+        free(indices);
+        return;
     }
-    
-    // Simple bubble sort using majority rule comparisons
-    for (int i = 0; i < n - 1; i++) {
-        for (int j = 0; j < n - i - 1; j++) {
-            int cand_a = indices[j];
-            int cand_b = indices[j + 1];
-            
-            // Use majority rule: if more voters prefer B over A, swap them
-            if (rf->prefmat[cand_b][cand_a] > rf->prefmat[cand_a][cand_b]) {
-                // Swap indices
-                int temp = indices[j];
-                indices[j] = indices[j + 1];
-                indices[j + 1] = temp;
-            }
-        }
-    }
-    
+
+    fprintf(outfile, "Best of %d randomized runs, Kemeny score %lld\n",
+            rf->opts.kwiksort_reps > 0 ? rf->opts.kwiksort_reps : 1, score);
+
     // Print final ranking
-    fprintf(outfile, "\nFinal Quicksort Ranking:\n");
+    fprintf(outfile, "\nFinal KwikSort Ranking:\n");
     for (int i = 0; i < n; i++) {
         int idx = indices[i];
         fprintf(outfile, "%d. %s\n", i + 1, rf->unnames[idx]);
     }
-}
\ No newline at end of file
+
+    free(indices);
+}
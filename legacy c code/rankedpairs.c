@@ -3,6 +3,34 @@
 #include <stdlib.h>
 #include <string.h>
 #include "ranksfile.h"
+#include "bitset.h"
+
+//-----------------------------------------------------
+// Ranked Pairs (Tideman)
+//-----------------------------------------------------
+// Majority edges u -> v (m(u,v) > 0), read off the win bits
+// of the majority tournament, are locked from the largest
+// margin down, skipping any edge that would close a
+// cycle. Edges are bucketed by margin; within one margin
+// group they are taken in the order of their pair (lower
+// candidate index first), so ties are broken the same way on
+// every run.
+//
+// The locked graph is kept as its transitive closure: a
+// bitset row reach[a] per candidate holding everything a
+// reaches, itself included, and its transpose from[a]
+// holding everything that reaches a. Locking u -> v would
+// close a cycle exactly when v already reaches u, a single
+// bit test. When it is locked, every x in from[u] now
+// reaches all of reach[v], and every y in reach[v] is now
+// reached from all of from[u]. Edges already implied (u
+// reaches v) change nothing.
+//
+// Every locked pair is ordered in the closure, and a
+// candidate reaches strictly more than anything below it, so
+// sorting by the size of reach[] (largest first) gives the
+// ranking.
+//-----------------------------------------------------
 
 typedef struct {
     int from;
@@ -10,79 +38,117 @@ typedef struct {
     int margin;
 } Edge;
 
-static int has_path(int **locked, int start, int target, int ncands, int *visited) {
-    if (start == target) return 1;
-    visited[start] = 1;
-    for (int v = 0; v < ncands; ++v) {
-        if (locked[start][v] && !visited[v]) {
-            if (has_path(locked, v, target, ncands, visited)) return 1;
-        }
-    }
-    return 0;
-}
+typedef struct {
+    int reach;
+    int cand;
+} ReachCount;
 
-static int compare_edges(const void *a, const void *b) {
-    const Edge *ea = (const Edge *)a;
-    const Edge *eb = (const Edge *)b;
-    return eb->margin - ea->margin;
+static int by_reach_desc(const void *a, const void *b) {
+    const ReachCount *x = a, *y = b;
+    if (x->reach != y->reach) return y->reach - x->reach;
+    return x->cand - y->cand;
 }
 
-void compute_ranked_pairs(RanksFile *rf, FILE *outfile) {
+//-----------------------------------------------------
+// Fills perm with the Ranked Pairs ranking and returns its
+// Kemeny score, or KEMENY_NO_SCORE if out of memory
+//-----------------------------------------------------
+long long ranked_pairs_solve(RanksFile *rf, int *perm) {
     int m = rf->ncands;
-    int max_edges = m * (m - 1);
-    Edge *edges = malloc(sizeof(Edge) * max_edges);
-    int edge_count = 0;
+    int nw = BITSET_WORDS(m);
+    int maxmargin = 0;
+    long long edge_count = 0;
+    long long max_edges = 0;
+    long long score = KEMENY_NO_SCORE;
 
+    const Tournament *t = ranksfile_tournament(rf);
+    if (!t) return score;
+    for (int a = 0; a < m; ++a) max_edges += bitset_count(&t->wins[(size_t)a * nw], nw);
+
+    Edge *found = malloc(sizeof(Edge) * (max_edges > 0 ? max_edges : 1));
+    Edge *edges = malloc(sizeof(Edge) * (max_edges > 0 ? max_edges : 1));
+    uint64_t *reach = calloc((size_t)m * nw + 1, sizeof(uint64_t));
+    uint64_t *from = calloc((size_t)m * nw + 1, sizeof(uint64_t));
+    uint64_t *ru = malloc((nw + 1) * sizeof(uint64_t));     // reach[u] before a lock
+    ReachCount *rc = malloc(sizeof(ReachCount) * (m > 0 ? m : 1));
+    long long *bucket = NULL;
+    if (!found || !edges || !reach || !from || !ru || !rc) goto fail;
+
+    // Majority edges, one per pair i < j that is not tied
     for (int i = 0; i < m; ++i) {
-        for (int j = 0; j < m; ++j) {
-            if (i != j && rf->prefmat[i][j] > 0) {
-                edges[edge_count++] = (Edge){i, j, rf->prefmat[i][j]};
+        const int *row = &PREF(rf, i, 0);
+        const uint64_t *tie = &t->ties[(size_t)i * nw];
+        for (int w = (i + 1) >> 6; w < nw; ++w) {
+            uint64_t bits = ~tie[w];
+            if (w == (i + 1) >> 6) bits &= ~(uint64_t)0 << ((i + 1) & 63);
+            if (w == nw - 1 && (m & 63)) bits &= ((uint64_t)1 << (m & 63)) - 1;
+            for (; bits; bits &= bits - 1) {
+                int j = w * 64 + __builtin_ctzll(bits);
+                int d = row[j];
+                found[edge_count++] = d > 0 ? (Edge){i, j, d} : (Edge){j, i, -d};
+                if (abs(d) > maxmargin) maxmargin = abs(d);
             }
         }
     }
 
-    qsort(edges, edge_count, sizeof(Edge), compare_edges);
+    // Bucket them by margin, largest first (a stable counting sort)
+    bucket = calloc((size_t)maxmargin + 2, sizeof(long long));
+    if (!bucket) goto fail;
+    for (long long e = 0; e < edge_count; ++e) bucket[maxmargin - found[e].margin + 1]++;
+    for (int d = 1; d <= maxmargin + 1; ++d) bucket[d] += bucket[d - 1];
+    for (long long e = 0; e < edge_count; ++e) edges[bucket[maxmargin - found[e].margin]++] = found[e];
 
-    int **locked = malloc(sizeof(int *) * m);
-    for (int i = 0; i < m; ++i) {
-        locked[i] = calloc(m, sizeof(int));
+    // Lock phase over the closure
+    for (int a = 0; a < m; ++a) {
+        bit_set(&reach[(size_t)a * nw], a);
+        bit_set(&from[(size_t)a * nw], a);
     }
-
-    for (int i = 0; i < edge_count; ++i) {
-        int u = edges[i].from;
-        int v = edges[i].to;
-        int *visited = calloc(m, sizeof(int));
-        if (!has_path(locked, v, u, m, visited)) {
-            locked[u][v] = 1;
-        }
-        free(visited);
+    for (long long e = 0; e < edge_count; ++e) {
+        int u = edges[e].from;
+        int v = edges[e].to;
+        const uint64_t *rv = &reach[(size_t)v * nw];
+        const uint64_t *fu = &from[(size_t)u * nw];
+        if (bit_test(rv, u)) continue;                       // Would close a cycle
+        if (bit_test(&reach[(size_t)u * nw], v)) continue;   // Already implied
+        // Rows that already reach v (or are reached from u) hold
+        // the new bits, so only from[u] - from[v] and
+        // reach[v] - reach[u] are visited
+        const uint64_t *fv = &from[(size_t)v * nw];
+        memcpy(ru, &reach[(size_t)u * nw], nw * sizeof(uint64_t));
+        for (int w = 0; w < nw; ++w)
+            for (uint64_t bits = fu[w] & ~fv[w]; bits; bits &= bits - 1)
+                bitset_or(&reach[(size_t)(w * 64 + __builtin_ctzll(bits)) * nw], rv, nw);
+        for (int w = 0; w < nw; ++w)
+            for (uint64_t bits = rv[w] & ~ru[w]; bits; bits &= bits - 1)
+                bitset_or(&from[(size_t)(w * 64 + __builtin_ctzll(bits)) * nw], fu, nw);
     }
 
-    int *indegree = calloc(m, sizeof(int));
-    for (int u = 0; u < m; ++u) {
-        for (int v = 0; v < m; ++v) {
-            if (locked[u][v]) indegree[v]++;
-        }
-    }
+    // Topological order: more reached means ranked higher
+    for (int a = 0; a < m; ++a)
+        rc[a] = (ReachCount){ bitset_count(&reach[(size_t)a * nw], nw), a };
+    qsort(rc, m, sizeof(ReachCount), by_reach_desc);
+    for (int i = 0; i < m; ++i) perm[i] = rc[i].cand;
+    score = ranking_score(rf, perm);
 
-    int *queue = malloc(sizeof(int) * m);
-    int *ranking = malloc(sizeof(int) * m);
-    int front = 0, back = 0;
+fail:
+    free(found);
+    free(edges);
+    free(bucket);
+    free(reach);
+    free(from);
+    free(ru);
+    free(rc);
+    return score;
+}
 
-    for (int i = 0; i < m; ++i) {
-        if (indegree[i] == 0) queue[back++] = i;
-    }
+void compute_ranked_pairs(RanksFile *rf, FILE *outfile) {
+    int m = rf->ncands;
+    int *ranking = malloc(sizeof(int) * (m > 0 ? m : 1));
 
-    int idx = 0;
-    while (front < back) {
-        int u = queue[front++];
-        ranking[idx++] = u;
-        for (int v = 0; v < m; ++v) {
-            if (locked[u][v]) {
-                indegree[v]--;
-                if (indegree[v] == 0) queue[back++] = v;
-            }
-        }
+    if (!ranking || ranked_pairs_solve(rf, ranking) == KEMENY_NO_SCORE) {
+        fprintf(outfile, "\nRanked Pairs: out of memory.\n");
+        free(ranking);
+        return;
     }
 
     fprintf(outfile, "\nRanked Pairs (Tideman) ranking:\n");
@@ -92,10 +158,5 @@ void compute_ranked_pairs(RanksFile *rf, FILE *outfile) {
     }
     fprintf(outfile, "\n");
 
-    free(edges);
-    for (int i = 0; i < m; ++i) free(locked[i]);
-    free(locked);
-    free(indegree);
-    free(queue);
     free(ranking);
 }
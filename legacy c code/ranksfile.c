@@ -0,0 +1,735 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <limits.h>
+#include <stdint.h>
+#include <time.h>
+#include <pthread.h>
+#include "ranksfile.h"
+
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <unistd.h>
+#endif
+
+// Defaults copied into every new RanksFile
+KemenyOptions kemeny_default_options = {
+    .nthreads = 1,
+    .node_limit = 10000000,
+    .decompose = 1,
+    .window = 12,
+    .restarts = 16,
+    .seed = 1,
+    .kwiksort_reps = 8,
+};
+
+// Largest total size of the per-thread count matrices; above
+// this the parallel build splits rows between threads instead
+#define SHARD_BUDGET ((size_t)256 << 20)
+
+// Below this many pair updates the build stays single-threaded
+#define PARALLEL_MIN_PAIRS (1LL << 18)
+
+//----------------------------------------------------------
+// Helper: aligned allocation of a zeroed block
+//----------------------------------------------------------
+// The preference matrix is the hot data of every solver, so
+// it starts on a cache line boundary.
+//----------------------------------------------------------
+static void *aligned_zalloc(size_t size) {
+    void *p = NULL;
+    if (size == 0) size = CACHELINE;
+    size = (size + CACHELINE - 1) / CACHELINE * CACHELINE;
+#ifdef _WIN32
+    p = _aligned_malloc(size, CACHELINE);
+#else
+    if (posix_memalign(&p, CACHELINE, size) != 0) p = NULL;
+#endif
+    if (p) memset(p, 0, size);
+    return p;
+}
+
+static void aligned_free(void *p) {
+#ifdef _WIN32
+    _aligned_free(p);
+#else
+    free(p);
+#endif
+}
+
+//----------------------------------------------------------
+// Function: ranksfile_create
+//----------------------------------------------------------
+// Allocates a RanksFile sized for exactly ncands candidates
+// and nrankers voters. The preference matrix is one
+// contiguous ncands x ncands block whose row stride equals
+// ncands, so small elections only touch a few kilobytes
+// (ranksfile_grow may widen it later).
+//
+// Returns NULL if memory cannot be allocated.
+//----------------------------------------------------------
+RanksFile *ranksfile_create(int ncands, int nrankers) {
+    RanksFile *rf = calloc(1, sizeof(RanksFile));
+    if (!rf) return NULL;
+
+    rf->ncands = ncands;
+    rf->nrankers = nrankers;
+    rf->stride = ncands;
+    rf->opts = kemeny_default_options;
+
+    rf->prefmat = aligned_zalloc((size_t)ncands * ncands * sizeof(int));
+    int ok = nametable_init(&rf->names, ncands);
+    rf->unnames = rf->names.names;
+
+    if (!rf->prefmat || !ok) {
+        ranksfile_destroy(rf);
+        return NULL;
+    }
+    return rf;
+}
+
+//----------------------------------------------------------
+// Function: ranksfile_destroy
+//----------------------------------------------------------
+// Frees the RanksFile and everything it owns. Accepts NULL.
+//----------------------------------------------------------
+void ranksfile_destroy(RanksFile *rf) {
+    if (!rf) return;
+    margin_destroy(rf->margins);
+    tournament_destroy(rf->tournament);
+    components_destroy(rf->components);
+    aligned_free(rf->prefmat);
+    nametable_free(&rf->names);
+    if (rf->cache) {
+        unmap_file(rf->cache);   // After the margins that point into it
+        free(rf->cache);
+    }
+    free(rf);
+}
+
+//----------------------------------------------------------
+// Function: ranksfile_add_ballot
+//----------------------------------------------------------
+// For each pair (i,j) where i is ranked before j, adds weight
+// to prefmat[i][j] (i preferred to j) and subtracts it from
+// prefmat[j][i]. A ballot that occurs many times is added
+// once with its multiplicity as weight. Candidates sharing a
+// level (a tie group in .toc files) are not compared.
+//----------------------------------------------------------
+void ranksfile_add_ballot(RanksFile *rf, const int *cands, const int *levels, int n, int weight) {
+    for (int i = 0; i < n - 1; i++) {
+        int *row = &PREF(rf, cands[i], 0);
+        for (int j = i + 1; j < n; j++) {
+            if (levels && levels[i] == levels[j]) continue;   // Tied, no preference
+            row[cands[j]] += weight;                       // i preferred over j
+            PREF(rf, cands[j], cands[i]) -= weight;        // j less preferred than i
+            rf->nprefs += weight;                          // Count total pairwise prefs
+        }
+    }
+}
+
+//----------------------------------------------------------
+// Function: ranksfile_grow
+//----------------------------------------------------------
+// Makes room for ncands candidates in a RanksFile that is
+// already filled, for elections whose candidates are not
+// known up front (stream.c). The new rows and columns start
+// at zero. The row stride at least doubles on each move, so
+// a run of single additions copies the matrix only
+// O(log n) times. The cached margins, tournament and
+// components no longer match and are dropped.
+//
+// Returns 0 (rf unchanged) if memory cannot be allocated.
+//----------------------------------------------------------
+int ranksfile_grow(RanksFile *rf, int ncands) {
+    if (ncands <= rf->ncands) return 1;
+
+    if (ncands > rf->stride) {
+        int stride = rf->stride > 0 ? 2 * rf->stride : 16;
+        while (stride < ncands) stride *= 2;
+        int *mat = aligned_zalloc((size_t)stride * stride * sizeof(int));
+        if (!mat) return 0;
+        for (int a = 0; a < rf->ncands; a++)
+            memcpy(&mat[(size_t)a * stride], &PREF(rf, a, 0), rf->ncands * sizeof(int));
+        aligned_free(rf->prefmat);
+        rf->prefmat = mat;
+        rf->stride = stride;
+    }
+    rf->ncands = ncands;
+
+    margin_destroy(rf->margins);
+    tournament_destroy(rf->tournament);
+    components_destroy(rf->components);
+    rf->margins = NULL;
+    rf->tournament = NULL;
+    rf->components = NULL;
+    return 1;
+}
+
+//----------------------------------------------------------
+// Function: ranksfile_update
+//----------------------------------------------------------
+// Adds one more voter's ballot to a RanksFile that solvers
+// have already run on. Besides the matrix, the cached
+// margins and tournament are corrected on the ballot's own
+// pairs only, O(k^2) for k candidates, instead of being
+// rebuilt; the components are dropped, as one pair can merge
+// or split them. Margins stored as int16 are dropped too
+// once the voter count no longer fits (see margin.c).
+//----------------------------------------------------------
+void ranksfile_update(RanksFile *rf, const int *cands, const int *levels, int n, int weight) {
+    ranksfile_add_ballot(rf, cands, levels, n, weight);
+    rf->nrankers += weight;
+    if (rf->nballots >= 0) rf->nballots++;
+
+    if (rf->margins && !margin_update(rf->margins, rf, cands, n)) {
+        margin_destroy(rf->margins);
+        rf->margins = NULL;
+    }
+    if (rf->tournament) tournament_update(rf->tournament, rf, cands, levels, n, weight);
+    components_destroy(rf->components);
+    rf->components = NULL;
+}
+
+//----------------------------------------------------------
+// Function: ranksfile_margins
+//----------------------------------------------------------
+// The packed margin matrix is derived from prefmat once and
+// shared by every solver that runs on rf.
+//----------------------------------------------------------
+const MarginMatrix *ranksfile_margins(RanksFile *rf) {
+    if (!rf->margins) rf->margins = margin_create(rf);
+    return rf->margins;
+}
+
+//----------------------------------------------------------
+// Function: ranksfile_tournament
+//----------------------------------------------------------
+// The majority tournament is read from prefmat once and
+// shared by every pairwise-majority method run on rf.
+//----------------------------------------------------------
+const Tournament *ranksfile_tournament(RanksFile *rf) {
+    if (!rf->tournament) rf->tournament = tournament_create(rf);
+    return rf->tournament;
+}
+
+//----------------------------------------------------------
+// Function: ranksfile_components
+//----------------------------------------------------------
+// Like the margins, the majority-graph components are found
+// once and shared by every solver that runs on rf.
+//----------------------------------------------------------
+const Components *ranksfile_components(RanksFile *rf) {
+    const Tournament *t = ranksfile_tournament(rf);
+    if (!rf->components && t) rf->components = components_create(t);
+    return rf->components;
+}
+
+//----------------------------------------------------------
+// Function: ranksfile_threads
+//----------------------------------------------------------
+int ranksfile_threads(const RanksFile *rf) {
+    int t = rf->opts.nthreads;
+    if (t <= 0) {
+#ifdef _WIN32
+        SYSTEM_INFO si;
+        GetSystemInfo(&si);
+        t = (int)si.dwNumberOfProcessors;
+#else
+        t = (int)sysconf(_SC_NPROCESSORS_ONLN);
+#endif
+    }
+    return t < 1 ? 1 : t;
+}
+
+//----------------------------------------------------------
+// Function: monotonic_ms
+//----------------------------------------------------------
+// Milliseconds on a monotonic clock, for time budgets and
+// timings: unlike the wall clock it is never stepped (by
+// NTP, say), so a deadline cannot fire early or late. Only
+// differences between two readings are meaningful.
+//----------------------------------------------------------
+double monotonic_ms(void) {
+#if defined(_WIN32)
+    LARGE_INTEGER count, freq;
+    QueryPerformanceCounter(&count);
+    QueryPerformanceFrequency(&freq);
+    return count.QuadPart * 1000.0 / freq.QuadPart;
+#elif defined(CLOCK_MONOTONIC)
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1000.0 + ts.tv_nsec / 1e6;
+#else
+    struct timespec ts;
+    timespec_get(&ts, TIME_UTC);
+    return ts.tv_sec * 1000.0 + ts.tv_nsec / 1e6;
+#endif
+}
+
+//----------------------------------------------------------
+// Function: ranking_score
+//----------------------------------------------------------
+// Sums the margins of every pair the ranking settles, one
+// contiguous prefmat row per candidate. O(n^2).
+//----------------------------------------------------------
+long long ranking_score(const RanksFile *rf, const int *perm) {
+    long long s = 0;
+    for (int i = 0; i < rf->ncands; i++) {
+        const int *row = &PREF(rf, perm[i], 0);
+        for (int j = i + 1; j < rf->ncands; j++) s += row[perm[j]];
+    }
+    return s;
+}
+
+static int by_key_desc(const void *a, const void *b) {
+    const KeyedCand *x = a, *y = b;
+    if (x->key != y->key) return (x->key < y->key) ? 1 : -1;
+    return x->cand - y->cand;
+}
+
+//----------------------------------------------------------
+// Function: sort_keyed_desc
+//----------------------------------------------------------
+// Orders candidates by decreasing key (a Borda or Copeland
+// score, say). Ties go to the lower index, so the order is
+// deterministic.
+//----------------------------------------------------------
+void sort_keyed_desc(KeyedCand *kc, int n) {
+    qsort(kc, n, sizeof(KeyedCand), by_key_desc);
+}
+
+//----------------------------------------------------------
+// Parallel matrix construction
+//----------------------------------------------------------
+// Building prefmat is the only step whose cost grows with
+// the number of voters. With several threads, ballots are
+// split into contiguous ranges of about equal pair work and
+// each thread counts "a before b" into a private matrix
+// (a shard). Only one entry is written per pair; the shards
+// are then folded into prefmat[a][b] += cnt[a][b] - cnt[b][a]
+// tile by tile, with threads splitting the rows.
+//
+// If one shard per thread would not fit in SHARD_BUDGET,
+// every thread scans all ballots instead and only updates
+// the rows of prefmat it owns.
+//----------------------------------------------------------
+typedef struct {
+    RanksFile *rf;
+    const BallotSet *bs;
+    int b0, b1;           // Ballot range (shard mode)
+    int r0, r1;           // Row range (fold and row mode)
+    int *shard;           // Private counts (shard mode), NULL in row mode
+    int **shards;         // All shards (fold phase)
+    int nshards;
+    long long nprefs;     // Pairs counted by this thread
+} BuildTask;
+
+static inline int ballot_weight(const BallotSet *bs, int b) {
+    return bs->weights ? bs->weights[b] : 1;
+}
+
+static void *count_shard(void *arg) {
+    BuildTask *t = arg;
+    const BallotSet *bs = t->bs;
+    int n = t->rf->ncands;
+    long long np = 0;
+
+    for (int b = t->b0; b < t->b1; b++) {
+        const int *c = &bs->cands[bs->offsets[b]];
+        const int *lv = bs->levels ? &bs->levels[bs->offsets[b]] : NULL;
+        int len = (int)(bs->offsets[b + 1] - bs->offsets[b]);
+        int w = ballot_weight(bs, b);
+        for (int i = 0; i < len - 1; i++) {
+            int *row = &t->shard[(size_t)c[i] * n];
+            for (int j = i + 1; j < len; j++) {
+                if (lv && lv[i] == lv[j]) continue;   // Tied, no preference
+                row[c[j]] += w;
+                np += w;
+            }
+        }
+    }
+    t->nprefs = np;
+    return NULL;
+}
+
+static void *fold_shards(void *arg) {
+    BuildTask *t = arg;
+    RanksFile *rf = t->rf;
+    int n = rf->ncands;
+    const int TILE = 64;
+
+    for (int a0 = t->r0; a0 < t->r1; a0 += TILE) {
+        int a1 = a0 + TILE < t->r1 ? a0 + TILE : t->r1;
+        for (int b0 = 0; b0 < n; b0 += TILE) {
+            int b1 = b0 + TILE < n ? b0 + TILE : n;
+            for (int s = 0; s < t->nshards; s++) {
+                const int *cnt = t->shards[s];
+                for (int a = a0; a < a1; a++) {
+                    int *row = &PREF(rf, a, 0);
+                    for (int b = b0; b < b1; b++)
+                        row[b] += cnt[(size_t)a * n + b] - cnt[(size_t)b * n + a];
+                }
+            }
+        }
+    }
+    return NULL;
+}
+
+static void *count_rows(void *arg) {
+    BuildTask *t = arg;
+    RanksFile *rf = t->rf;
+    const BallotSet *bs = t->bs;
+    long long np = 0;
+
+    for (int b = 0; b < bs->nballots; b++) {
+        const int *c = &bs->cands[bs->offsets[b]];
+        const int *lv = bs->levels ? &bs->levels[bs->offsets[b]] : NULL;
+        int len = (int)(bs->offsets[b + 1] - bs->offsets[b]);
+        int w = ballot_weight(bs, b);
+        for (int i = 0; i < len; i++) {
+            if (c[i] < t->r0 || c[i] >= t->r1) continue;  // Not my row
+            int *row = &PREF(rf, c[i], 0);
+            for (int j = 0; j < len; j++) {
+                if (j == i || (lv && lv[i] == lv[j])) continue;
+                if (j > i) { row[c[j]] += w; np += w; }  // i preferred over j
+                else row[c[j]] -= w;                     // j preferred over i
+            }
+        }
+    }
+    t->nprefs = np;
+    return NULL;
+}
+
+//----------------------------------------------------------
+// Function: run_parallel
+//----------------------------------------------------------
+// Calls fn on each of the ntasks argument blocks (argsize
+// bytes apart in args), one thread per task, the calling
+// thread taking the first, and waits for all of them.
+//----------------------------------------------------------
+void run_parallel(void *(*fn)(void *), void *args, size_t argsize, int ntasks) {
+    char *base = args;
+    pthread_t *tid = malloc(ntasks * sizeof(pthread_t));
+    int *started = calloc(ntasks, sizeof(int));
+    for (int i = 1; i < ntasks; i++)
+        if (tid && started)
+            started[i] = pthread_create(&tid[i], NULL, fn, base + i * argsize) == 0;
+    if (ntasks > 0) fn(base);
+    for (int i = 1; i < ntasks; i++) {
+        if (started && started[i]) pthread_join(tid[i], NULL);
+        else fn(base + i * argsize);   // Could not start a thread: do it here
+    }
+    free(tid);
+    free(started);
+}
+
+//----------------------------------------------------------
+// Function: ranksfile_add_ballots
+//----------------------------------------------------------
+// Adds every ballot of bs to rf's preference matrix, with
+// the same result as calling ranksfile_add_ballot on each.
+// Returns 1, or 0 if the thread tasks cannot be allocated,
+// in which case rf is left unchanged.
+//----------------------------------------------------------
+int ranksfile_add_ballots(RanksFile *rf, const BallotSet *bs) {
+    int n = rf->ncands;
+    int nthreads = ranksfile_threads(rf);
+
+    // Estimate the work: pair updates per ballot
+    long long work = 0;
+    for (int b = 0; b < bs->nballots; b++) {
+        long long len = bs->offsets[b + 1] - bs->offsets[b];
+        work += len * (len - 1) / 2;
+    }
+    if (nthreads > n) nthreads = n > 0 ? n : 1;
+    if (nthreads <= 1 || work < PARALLEL_MIN_PAIRS) {
+        for (int b = 0; b < bs->nballots; b++)
+            ranksfile_add_ballot(rf, &bs->cands[bs->offsets[b]],
+                                 bs->levels ? &bs->levels[bs->offsets[b]] : NULL,
+                                 (int)(bs->offsets[b + 1] - bs->offsets[b]), ballot_weight(bs, b));
+        return 1;
+    }
+
+    BuildTask *tasks = calloc(nthreads, sizeof(BuildTask));
+    int **shards = calloc(nthreads, sizeof(int *));
+    int ok = tasks && shards;
+    if (ok && (size_t)nthreads * n * n * sizeof(int) <= SHARD_BUDGET) {
+        for (int t = 0; t < nthreads && ok; t++)
+            ok = (shards[t] = calloc((size_t)n * n, sizeof(int))) != NULL;
+    } else {
+        ok = 0;
+    }
+
+    if (ok) {
+        // Shard mode: split ballots into ranges of equal work
+        long long target = (work + nthreads - 1) / nthreads, acc = 0;
+        int b = 0;
+        for (int t = 0; t < nthreads; t++) {
+            tasks[t] = (BuildTask){ .rf = rf, .bs = bs, .b0 = b, .shard = shards[t] };
+            while (b < bs->nballots && (acc < target * (t + 1) || t == nthreads - 1)) {
+                long long len = bs->offsets[b + 1] - bs->offsets[b];
+                acc += len * (len - 1) / 2;
+                b++;
+            }
+            tasks[t].b1 = b;
+        }
+        run_parallel(count_shard, tasks, sizeof(BuildTask), nthreads);
+
+        // Fold the shards into prefmat, threads splitting the rows
+        for (int t = 0; t < nthreads; t++) {
+            rf->nprefs += tasks[t].nprefs;
+            tasks[t].shards = shards;
+            tasks[t].nshards = nthreads;
+            tasks[t].r0 = (int)((long long)n * t / nthreads);
+            tasks[t].r1 = (int)((long long)n * (t + 1) / nthreads);
+        }
+        run_parallel(fold_shards, tasks, sizeof(BuildTask), nthreads);
+    } else if (tasks) {
+        // Row mode: every thread scans all ballots, updates its own rows
+        for (int t = 0; t < nthreads; t++) {
+            tasks[t] = (BuildTask){ .rf = rf, .bs = bs,
+                                    .r0 = (int)((long long)n * t / nthreads),
+                                    .r1 = (int)((long long)n * (t + 1) / nthreads) };
+        }
+        run_parallel(count_rows, tasks, sizeof(BuildTask), nthreads);
+        for (int t = 0; t < nthreads; t++)
+            rf->nprefs += tasks[t].nprefs;
+    }
+
+    int built = tasks != NULL;
+    for (int t = 0; shards && t < nthreads; t++) free(shards[t]);
+    free(shards);
+    free(tasks);
+    return built;
+}
+
+//----------------------------------------------------------
+// Ballot sets
+//----------------------------------------------------------
+void ballotset_init(BallotSet *bs) {
+    memset(bs, 0, sizeof(BallotSet));
+}
+
+void ballotset_free(BallotSet *bs) {
+    free(bs->offsets);
+    free(bs->cands);
+    free(bs->levels);
+    free(bs->weights);
+    memset(bs, 0, sizeof(BallotSet));
+}
+
+// Grows *arr to cap elements of size bytes; 0 if out of memory
+static int resize(void *arr, size_t cap, size_t size) {
+    if (cap > SIZE_MAX / size) return 0;
+    void *bigger = realloc(*(void **)arr, cap * size);
+    if (!bigger) return 0;
+    *(void **)arr = bigger;
+    return 1;
+}
+
+// Capacity of at least need, doubling from cap (or first); 0 if
+// it cannot be represented
+static size_t grow_cap(size_t cap, size_t first, size_t need) {
+    if (cap == 0) cap = first;
+    while (cap < need) {
+        if (cap > SIZE_MAX / 2) return 0;
+        cap *= 2;
+    }
+    return cap;
+}
+
+int ballotset_add(BallotSet *bs, const int *cands, const int *levels, int n, int weight) {
+    size_t used = bs->nballots ? bs->offsets[bs->nballots] : 0;
+    if (n < 0 || bs->nballots == INT_MAX || (size_t)n > SIZE_MAX - used) return 0;
+
+    // Room for one more ballot and its n entries
+    if ((size_t)bs->nballots + 2 > bs->bcap) {
+        size_t cap = grow_cap(bs->bcap, 64, (size_t)bs->nballots + 2);
+        if (!cap || !resize(&bs->offsets, cap, sizeof(size_t))) return 0;
+        if (bs->weights && !resize(&bs->weights, cap, sizeof(int))) return 0;
+        bs->bcap = cap;
+        bs->offsets[0] = 0;
+    }
+    if (used + n > bs->ncap) {
+        size_t cap = grow_cap(bs->ncap, 1024, used + n);
+        if (!cap || !resize(&bs->cands, cap, sizeof(int))) return 0;
+        if (bs->levels && !resize(&bs->levels, cap, sizeof(int))) return 0;
+        bs->ncap = cap;
+    }
+
+    // First ballot with a tie: start recording levels
+    int ties = 0;
+    for (int i = 0; levels && i < n - 1; i++)
+        if (levels[i] == levels[i + 1]) ties = 1;
+    if (ties && !bs->levels) {
+        bs->levels = malloc((size_t)bs->ncap * sizeof(int));
+        if (!bs->levels) return 0;
+        for (int b = 0; b < bs->nballots; b++)
+            for (size_t k = bs->offsets[b]; k < bs->offsets[b + 1]; k++)
+                bs->levels[k] = (int)(k - bs->offsets[b]);
+    }
+
+    // First ballot with a multiplicity: start recording weights
+    if (weight != 1 && !bs->weights) {
+        bs->weights = malloc((size_t)bs->bcap * sizeof(int));
+        if (!bs->weights) return 0;
+        for (int b = 0; b < bs->nballots; b++) bs->weights[b] = 1;
+    }
+
+    memcpy(&bs->cands[used], cands, n * sizeof(int));
+    if (bs->levels) {
+        for (int i = 0; i < n; i++)
+            bs->levels[used + i] = levels ? levels[i] : i;
+    }
+    if (bs->weights) bs->weights[bs->nballots] = weight;
+    bs->nballots++;
+    bs->offsets[bs->nballots] = used + n;
+    return 1;
+}
+
+//----------------------------------------------------------
+// Function: ranksfile_adopt_names
+//----------------------------------------------------------
+// Replaces rf's name table with nt, e.g. the table the parser
+// filled while reading. nt is left empty.
+//----------------------------------------------------------
+void ranksfile_adopt_names(RanksFile *rf, NameTable *nt) {
+    nametable_free(&rf->names);
+    rf->names = *nt;
+    rf->unnames = rf->names.names;
+    memset(nt, 0, sizeof(NameTable));
+}
+
+//----------------------------------------------------------
+// Name table
+//----------------------------------------------------------
+// Candidate names are interned once in an open-addressing
+// hash table (linear probing, FNV-1a hash), so the parser
+// maps each token to its index in O(1) instead of comparing
+// it against every known name. The table is kept at most
+// half full.
+//----------------------------------------------------------
+static unsigned hash_name(const char *name, size_t len) {
+    unsigned h = 2166136261u;
+    for (size_t i = 0; i < len; i++) {
+        h ^= (unsigned char)name[i];
+        h *= 16777619u;
+    }
+    return h;
+}
+
+static int alloc_slots(NameTable *nt, int nslots) {
+    int *slots = malloc(nslots * sizeof(int));
+    unsigned *hashes = malloc(nslots * sizeof(unsigned));
+    if (!slots || !hashes) {
+        free(slots);
+        free(hashes);
+        return 0;
+    }
+    for (int i = 0; i < nslots; i++) slots[i] = -1;
+    free(nt->slots);
+    free(nt->hashes);
+    nt->slots = slots;
+    nt->hashes = hashes;
+    nt->nslots = nslots;
+    return 1;
+}
+
+int nametable_init(NameTable *nt, int cap) {
+    memset(nt, 0, sizeof(NameTable));
+    if (cap < 16) cap = 16;
+    int nslots = 32;
+    while (nslots < 2 * cap) nslots *= 2;
+
+    nt->names = calloc(cap, sizeof(char *));
+    if (!nt->names || !alloc_slots(nt, nslots)) {
+        nametable_free(nt);
+        return 0;
+    }
+    nt->cap = cap;
+    return 1;
+}
+
+void nametable_free(NameTable *nt) {
+    for (int i = 0; i < nt->count; i++)
+        free(nt->names[i]);
+    free(nt->names);
+    free(nt->slots);
+    free(nt->hashes);
+    memset(nt, 0, sizeof(NameTable));
+}
+
+// Slot holding name, or the empty slot where it would go
+static int probe(const NameTable *nt, const char *name, size_t len, unsigned h) {
+    int mask = nt->nslots - 1;
+    int s = (int)(h & (unsigned)mask);
+    while (nt->slots[s] != -1) {
+        if (nt->hashes[s] == h) {
+            const char *other = nt->names[nt->slots[s]];
+            if (strncmp(other, name, len) == 0 && other[len] == '\0')
+                return s;
+        }
+        s = (s + 1) & mask;
+    }
+    return s;
+}
+
+int nametable_find(const NameTable *nt, const char *name, size_t len) {
+    if (nt->nslots == 0) return -1;
+    return nt->slots[probe(nt, name, len, hash_name(name, len))];
+}
+
+int nametable_intern(NameTable *nt, const char *name, size_t len) {
+    if (nt->nslots == 0 && !nametable_init(nt, 16)) return -1;
+
+    unsigned h = hash_name(name, len);
+    int s = probe(nt, name, len, h);
+    if (nt->slots[s] != -1) return nt->slots[s];   // Already known
+
+    // Grow the index -> name array
+    if (nt->count == nt->cap) {
+        char **bigger = realloc(nt->names, 2 * nt->cap * sizeof(char *));
+        if (!bigger) return -1;
+        nt->names = bigger;
+        nt->cap *= 2;
+    }
+
+    // Rehash when the table would become more than half full
+    if (2 * (nt->count + 1) > nt->nslots) {
+        int *oldslots = nt->slots;
+        unsigned *oldhashes = nt->hashes;
+        int oldn = nt->nslots;
+        nt->slots = NULL;
+        nt->hashes = NULL;
+        if (!alloc_slots(nt, 2 * oldn)) {
+            nt->slots = oldslots;
+            nt->hashes = oldhashes;
+            nt->nslots = oldn;
+            return -1;
+        }
+        int mask = nt->nslots - 1;
+        for (int i = 0; i < oldn; i++) {
+            if (oldslots[i] == -1) continue;
+            int t = (int)(oldhashes[i] & (unsigned)mask);
+            while (nt->slots[t] != -1) t = (t + 1) & mask;
+            nt->slots[t] = oldslots[i];
+            nt->hashes[t] = oldhashes[i];
+        }
+        free(oldslots);
+        free(oldhashes);
+        s = probe(nt, name, len, h);
+    }
+
+    char *copy = malloc(len + 1);
+    if (!copy) return -1;
+    memcpy(copy, name, len);
+    copy[len] = '\0';
+
+    int idx = nt->count++;
+    nt->names[idx] = copy;
+    nt->slots[s] = idx;
+    nt->hashes[s] = h;
+    return idx;
+}
@@ -2,34 +2,418 @@
 #define RANKSFILE_H
 
 #include <stdio.h>
+#include <stddef.h>
+#include <limits.h>
+#include <stdint.h>
 
-// Define constants for array limits
-#define MAXVOTERS 3000        // Maximum number of voters (rankers)
-#define MAXCANDS 1000         // Maximum number of candidates
-#define MAXCANDNAMELEN 64     // Maximum length of candidate names
-#define BUFFLEN 1024          // Maximum input line length
+#define CACHELINE 64          // Alignment of the preference matrix
 
-// Define a structure to hold all the ranking data
+// Interned candidate names: an open-addressing hash table
+// mapping each name to its candidate index, plus the
+// index -> name array used when printing results.
 typedef struct {
-    char thedata[MAXVOTERS][BUFFLEN];         // Raw input lines (each voter's ranking)
-    int nrankers;                             // Number of voters (lines read)
+    int count;            // Number of names interned
+    int cap;              // Capacity of names[]
+    char **names;         // names[i] is the name of candidate i
+    int nslots;           // Size of slots[] (power of two)
+    int *slots;           // Candidate index per slot, -1 if empty
+    unsigned *hashes;     // Hash of the name stored in each slot
+} NameTable;
+
+// A read-only view of a whole input file, memory-mapped when possible
+typedef struct {
+    const char *data;     // File contents (not NUL-terminated)
+    size_t len;           // Number of bytes
+    int mapped;           // 1 if data is an mmap, 0 if a heap copy
+} MappedFile;
+
+// Run-time settings shared by the loaders and solvers.
+// Every RanksFile gets a copy of kemeny_default_options when
+// it is created; main() fills those from the command line.
+typedef struct {
+    int nthreads;            // Worker threads (0 = one per online CPU)
+    long long node_limit;    // Branch-and-bound node budget (0 = unlimited)
+    int decompose;           // Solve majority-graph components separately
+    int first_improvement;   // Local search takes the first improving move (0 = the best)
+    int window;              // Local search window length (at most WINDOW_MAX)
+    int restarts;            // Multi-start local search: number of descents
+    uint64_t seed;           // Seed of the randomized solvers
+    long long time_limit_ms; // Time budget of the anytime solvers (0 = none)
+    int kwiksort_reps;       // KwikSort: number of randomized runs, the best is kept
+} KemenyOptions;
+
+extern KemenyOptions kemeny_default_options;
+
+// Parsed ballots, kept as candidate indices so the matrix can
+// be built in bulk (and in parallel) once the candidate count
+// is known.
+typedef struct {
+    int nballots;         // Number of ballots
+    size_t *offsets;      // Ballot b is cands[offsets[b] .. offsets[b+1])
+    int *cands;           // Candidate indices, best first, all ballots back to back
+    int *levels;          // Tie level of each entry (NULL if no ballot has ties)
+    int *weights;         // Multiplicity of each ballot (NULL if all are 1)
+    size_t ncap, bcap;    // Capacity of cands/levels and offsets/weights
+} BallotSet;
+
+// Packed skew-symmetric margin matrix (see margin.c): the
+// strict upper triangle of prefmat, int16 or int32 per entry
+typedef struct {
+    int n;                // Number of candidates
+    int width;            // Bytes per entry: 2 or 4
+    void *tri;            // n(n-1)/2 margins, row a holds m(a, a+1..n-1)
+    int borrowed;         // tri lies in a mapped cache file and is not freed
+} MarginMatrix;
+
+// Majority tournament (see tournament.c): bit rows of the
+// pairwise contests and the per-candidate scores derived
+// from them
+typedef struct {
+    int n;                // Number of candidates
+    int nwords;           // 64-bit words per bit row
+    uint64_t *wins;       // Row a, bit b: m(a,b) > 0
+    uint64_t *ties;       // Row a, bit b: m(a,b) == 0, b != a
+    long long *borda;     // Sum of the positive margins of each candidate
+    int *copeland2;       // Twice the Copeland score: 2 per win, 1 per tie
+} Tournament;
+
+// Strongly connected components of the majority graph (see
+// components.c), in the order a Kemeny consensus ranks them
+typedef struct {
+    int ncomps;           // Number of components
+    int *start;           // Component k is members[start[k] .. start[k+1])
+    int *members;         // Candidates grouped by component, best component first
+    int largest;          // Size of the largest component
+} Components;
+
+// Counters left by the last solver run on a RanksFile
+typedef struct {
+    long long nodes;      // Search nodes (branch and bound) or moves (annealing) explored
+    long long gap;        // Proven optimality gap, 0 if optimal
+} SolveStats;
+
+// Define a structure to hold all the ranking data.
+// Everything is sized at runtime from the actual number of
+// candidates and voters (see ranksfile_create).
+typedef struct {
+    int nrankers;                             // Number of voters (sum of ballot multiplicities)
+    int nballots;                             // Number of distinct ballots (input lines) read, -1 if unknown
     int ncands;                               // Number of unique candidates
-    int nprefs;                               // Number of pairwise preferences recorded
-    int prefmat[MAXCANDS][MAXCANDS];          // Preference matrix: prefmat[i][j] counts how many prefer i over j
-    char unnames[MAXCANDS][MAXCANDNAMELEN];   // List of candidate names
+    long long nprefs;                         // Number of pairwise preferences recorded
+    int stride;                               // Row stride of prefmat (>= ncands, see ranksfile_grow)
+    int *prefmat;                             // ncands x ncands preference matrix, cache-line aligned
+    NameTable names;                          // Candidate name <-> index table
+    char **unnames;                           // List of candidate names (== names.names)
+    KemenyOptions opts;                       // Settings for loaders and solvers
+    MarginMatrix *margins;                    // Packed margins, built on first use
+    Tournament *tournament;                   // Majority tournament, built on first use
+    Components *components;                   // Majority-graph components, built on first use
+    SolveStats stats;                         // Counters from the last solver run
+    MappedFile *cache;                        // Cache file holding margins->tri, NULL if none
 } RanksFile;
 
-// Declaration of the brute-force Kemeny function
+// prefmat[i][j] counts how many prefer i over j
+#define PREF(rf, i, j) ((rf)->prefmat[(size_t)(i) * (rf)->stride + (j)])
+
+// Allocate a zeroed RanksFile for ncands candidates and nrankers voters
+RanksFile *ranksfile_create(int ncands, int nrankers);
+
+// Free a RanksFile and everything it owns
+void ranksfile_destroy(RanksFile *rf);
+
+// Packed margin matrix of rf, built on first use and cached
+// (NULL if out of memory)
+const MarginMatrix *ranksfile_margins(RanksFile *rf);
+
+// Majority tournament of rf, built on first use and cached
+// (NULL if out of memory)
+const Tournament *ranksfile_tournament(RanksFile *rf);
+Tournament *tournament_create(const RanksFile *rf);
+void tournament_destroy(Tournament *t);
+void tournament_update(Tournament *t, const RanksFile *rf, const int *cands, const int *levels, int k,
+                       int weight);
+
+// Majority-graph components of rf, built on first use and
+// cached (NULL if out of memory)
+const Components *ranksfile_components(RanksFile *rf);
+
+// Copy of rf restricted to the k candidates cands[] (NULL if
+// out of memory)
+RanksFile *ranksfile_subset(const RanksFile *rf, const int *cands, int k);
+
+// Add one ballot with multiplicity weight to the preference matrix.
+// cands lists candidate indices from best to worst; if levels is not
+// NULL, candidates with equal levels are tied (no preference).
+void ranksfile_add_ballot(RanksFile *rf, const int *cands, const int *levels, int n, int weight);
+
+// Add one more voter's ballot to a RanksFile in use, keeping
+// the cached margins and tournament current (see ranksfile.c)
+void ranksfile_update(RanksFile *rf, const int *cands, const int *levels, int n, int weight);
+
+// Make room for ncands candidates (the new ones with no
+// preferences yet); 0 if out of memory
+int ranksfile_grow(RanksFile *rf, int ncands);
+
+// Add all ballots of bs to the preference matrix, using
+// rf->opts.nthreads worker threads; 0 if out of memory (rf
+// is then unchanged)
+int ranksfile_add_ballots(RanksFile *rf, const BallotSet *bs);
+
+// Number of worker threads to use for rf (resolves 0 to the CPU count)
+int ranksfile_threads(const RanksFile *rf);
+
+// Run fn on ntasks argument blocks of argsize bytes, one thread each
+void run_parallel(void *(*fn)(void *), void *args, size_t argsize, int ntasks);
+
+// Milliseconds on a monotonic clock (for time budgets and timings)
+double monotonic_ms(void);
+
+// Kemeny score of the full ranking perm: the sum of the margins
+// m(a,b) over all pairs with a ranked above b
+long long ranking_score(const RanksFile *rf, const int *perm);
+
+// A candidate with a sort key, for the score-ordered rankings
+typedef struct {
+    long long key;
+    int cand;
+} KeyedCand;
+
+// Sort kc by decreasing key, ties by increasing candidate index
+void sort_keyed_desc(KeyedCand *kc, int n);
+
+// Small PRNG (splitmix64) for the randomized solvers. Each
+// thread keeps its own state, so runs are reproducible from
+// the seed.
+static inline uint64_t rng_next(uint64_t *state) {
+    uint64_t z = (*state += 0x9E3779B97F4A7C15ULL);
+    z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ULL;
+    z = (z ^ (z >> 27)) * 0x94D049BB133111EBULL;
+    return z ^ (z >> 31);
+}
+
+// Uniform integer in [0, n)
+static inline int rng_below(uint64_t *state, int n) {
+    return (int)((rng_next(state) >> 32) * (uint64_t)n >> 32);
+}
+
+// Ballot set: append one ballot (levels may be NULL for a
+// strict order); returns 0 if out of memory
+void ballotset_init(BallotSet *bs);
+int ballotset_add(BallotSet *bs, const int *cands, const int *levels, int n, int weight);
+void ballotset_free(BallotSet *bs);
+
+// Hand a filled name table over to rf (nt is left empty)
+void ranksfile_adopt_names(RanksFile *rf, NameTable *nt);
+
+// Name table: init with room for cap names, free, and lookup.
+// nametable_intern returns the index of name[0..len), adding it
+// if it is new; -1 if out of memory.
+int nametable_init(NameTable *nt, int cap);
+void nametable_free(NameTable *nt);
+int nametable_find(const NameTable *nt, const char *name, size_t len);
+int nametable_intern(NameTable *nt, const char *name, size_t len);
+
+// Read voter rankings (one ballot per line) into a new RanksFile.
+// path NULL reads stdin; outfile NULL prints no summary.
+RanksFile *read_ranks_file(const char *path, FILE *outfile, int showinput);
+
+// Build a RanksFile from a strided voters x candidates array
+// of rank positions, lower is better (see readranks.c);
+// NULL if out of memory
+RanksFile *ranksfile_from_positions(const void *data, int itemsize, ptrdiff_t vstride, ptrdiff_t cstride,
+                                    int nvoters, int ncands, const KemenyOptions *opts);
+
+// Read a PrefLib .soc/.soi/.toc/.toi file into a new RanksFile
+RanksFile *read_preflib_file(const char *path, FILE *outfile);
+
+// Nonzero if path has a PrefLib extension
+int is_preflib_path(const char *path);
+
+// Binary election cache (see cache.c): the candidate names,
+// voter counts and packed margins of an election, written
+// after any parse and mapped back without the ballots.
+// write_cache_file returns 0 if path cannot be written.
+#define CACHE_EXT ".kmc"
+int is_cache_path(const char *path);
+int write_cache_file(RanksFile *rf, const char *path);
+RanksFile *read_cache_file(const char *path, FILE *outfile);
+
+// Read an election in whichever format path has: a cache
+// file, a PrefLib file, or ballot lines (stdin if NULL)
+RanksFile *read_election(const char *path, FILE *outfile, int showinput);
+
+// Partial aggregates (see merge.c): add the election src
+// into dst, matching candidates by name (0 if out of memory),
+// and read several elections into their sum
+int ranksfile_merge(RanksFile *dst, const RanksFile *src);
+RanksFile *read_merged(const char **paths, int npaths, FILE *outfile);
+
+// Map path (stdin if NULL); returns 0 if it cannot be read
+int map_file(const char *path, MappedFile *mf);
+void unmap_file(MappedFile *mf);
+
+// Ballot tokenizer over a mapped buffer: finds the next
+// whitespace-separated token on the current line, without
+// copying. Returns 1 with [*tok, *tok + *len) set, 0 at the
+// end of the line (the newline is consumed), -1 at the end
+// of the input.
+static inline int next_token(const char **p, const char *end, const char **tok, size_t *len) {
+    const char *s = *p;
+    while (s < end && (*s == ' ' || *s == '\t' || *s == '\r')) s++;
+    if (s == end) { *p = s; return -1; }
+    if (*s == '\n') { *p = s + 1; return 0; }
+    const char *t = s;
+    while (s < end && *s != ' ' && *s != '\t' && *s != '\r' && *s != '\n') s++;
+    *tok = t;
+    *len = (size_t)(s - t);
+    *p = s;
+    return 1;
+}
+
+// Margin matrix: build/free, single entry m(a,b), dense row
+// out[x] = m(c,x), score of a ranking given as positions
+// pos[c] (0 = best), and a contiguous sum used by the kernels
+MarginMatrix *margin_create(const RanksFile *rf);
+void margin_destroy(MarginMatrix *mm);
+int margin_at(const MarginMatrix *mm, int a, int b);
+void margin_row(const MarginMatrix *mm, int c, int *out);
+long long margin_score(const MarginMatrix *mm, const int *pos);
+int margin_update(MarginMatrix *mm, const RanksFile *rf, const int *cands, int k);
+
+// Exact and heuristic Kemeny solvers come in two forms: a
+// *_solve function that fills perm (best candidate first) and
+// returns its Kemeny score, or KEMENY_NO_SCORE if it cannot
+// run, and a compute_* function that prints the result.
+#define KEMENY_NO_SCORE LLONG_MIN
+
+typedef long long (*KemenySolver)(RanksFile *rf, int *perm);
+
+// Majority-graph components: build and free, and a solver
+// run on each component of rf when opts.decompose is set.
+// kemeny_solve_size is the most candidates one solver call
+// then gets.
+Components *components_create(const Tournament *t);
+void components_destroy(Components *cc);
+long long kemeny_solve(RanksFile *rf, KemenySolver solve, int *perm);
+int kemeny_solve_size(RanksFile *rf);
+
+// Exact Kemeny consensus by dynamic programming over subsets
+#define DP_MAXCANDS 25
+long long kemeny_dp_solve(RanksFile *rf, int *perm);
+void compute_kemeny_dp(RanksFile *rf, FILE *out);
+
+// Exact Kemeny consensus by branch and bound, seeded with the
+// heuristic; stops after opts.node_limit nodes (0 = no limit)
+long long kemeny_bnb_solve(RanksFile *rf, int *perm);
+void compute_kemeny_branch_bound(RanksFile *rf, FILE *out);
+
+// Exact Kemeny consensus by enumerating every ranking, split
+// across threads; the reference oracle for the other solvers
+#define BRUTEFORCE_MAXCANDS 13
+long long kemeny_bruteforce_solve(RanksFile *rf, int *perm);
 void compute_kemeny_bruteforce(RanksFile *rf, FILE *out);
 
+// Local search: insertion moves plus exact reordering of
+// windows of opts.window consecutive candidates
+#define WINDOW_MAX 16
+long long heuristic_kemeny_solve(RanksFile *rf, int *perm);
 void compute_heuristic_kemeny(RanksFile *rf, FILE *outfile);
 
+// One descent from the ranking already in perm
+long long local_search_kemeny(RanksFile *rf, int *perm);
+
+// Multi-start local search: opts.restarts descents from
+// diversified starts, split across threads
+long long multistart_kemeny_solve(RanksFile *rf, int *perm);
+void compute_multistart_kemeny(RanksFile *rf, FILE *outfile);
+
+// Anytime simulated annealing over insertion moves, bounded
+// by opts.time_limit_ms; the compute_* form streams each new
+// incumbent as it is found
+long long anneal_kemeny_solve(RanksFile *rf, int *perm);
+void compute_anneal_kemeny(RanksFile *rf, FILE *outfile);
+
+// Borda (sum of winning margins) and Copeland orders
+long long borda_solve(RanksFile *rf, int *perm);
 void compute_borda_heuristic(RanksFile *rf, FILE *outfile);
 
+long long copeland_solve(RanksFile *rf, int *perm);
 void compute_copeland_approximation(RanksFile *rf, FILE *out);
 
+// Ranked Pairs (Tideman) on a bitset transitive closure
+long long ranked_pairs_solve(RanksFile *rf, int *perm);
 void compute_ranked_pairs(RanksFile *rf, FILE *outfile);
 
+// Schulze (beatpath) ranking by a tiled, multithreaded
+// widest-path closure; ties broken by Borda score, then index
+long long schulze_solve(RanksFile *rf, int *perm);
+void compute_schulze(RanksFile *rf, FILE *outfile);
+
+// KwikSort on the majority tournament, best of
+// opts.kwiksort_reps randomized runs
+long long kwiksort_solve(RanksFile *rf, int *perm);
 void compute_quicksort_approximation(RanksFile *rf, FILE *out);
 
+// Streaming mode (see stream.c): ballots are added to a
+// resident election one at a time, and the consensus is
+// re-optimized on demand from the previous one
+typedef struct {
+    RanksFile *rf;
+    int *perm;            // Last consensus, best first
+    int nperm;            // Candidates it ranks (earlier ones)
+    int cap;              // Capacity of perm
+    long long score;      // Its Kemeny score
+    int refresh_every;    // Re-optimize after this many ballots (0 = on request only)
+    int pending;          // Ballots added since the last consensus
+} KemenyStream;
+
+void stream_init(KemenyStream *ks, RanksFile *rf);
+void stream_free(KemenyStream *ks);
+long long stream_consensus(KemenyStream *ks);
+int stream_serve(KemenyStream *ks, FILE *in, FILE *out);
+int stream_listen(KemenyStream *ks, const char *path, FILE *log);
+
+// Ranking methods by name (see methods.c)
+typedef struct {
+    const char *name;
+    void (*compute)(RanksFile *rf, FILE *outfile);
+    KemenySolver solve;   // The ranking alone, with its score
+    int decomposed;       // Solves each majority-graph component separately
+    const char *desc;
+} KemenyMethod;
+
+extern const KemenyMethod kemeny_methods[];
+extern const int kemeny_nmethods;
+
+// Method by name, NULL if there is none
+const KemenyMethod *kemeny_find_method(const char *name, size_t len);
+
+// Ranking of one method in perm and its score, through
+// kemeny_solve when the method is decomposed; KEMENY_NO_SCORE
+// if it cannot be found (too large or out of memory)
+long long kemeny_method_solve(RanksFile *rf, const KemenyMethod *m, int *perm);
+
+// Parse a comma-separated method list ("all" for every
+// method, "default" for the default preset); returns the
+// number selected or -1 if one is unknown
+int kemeny_select_methods(const char *list, const KemenyMethod **sel, int max);
+void kemeny_run_methods(RanksFile *rf, const KemenyMethod **sel, int nsel, FILE *outfile);
+
+// Run the methods named in list on rf; -1 if one is unknown
+int kemeny_run(RanksFile *rf, const char *list, FILE *outfile);
+
+// Batch mode (see batch.c): run the selected methods on every
+// election under directories or listed in manifests, over a
+// thread pool, one JSON line per election; returns the
+// number of unreadable elections, -1 if an input cannot be
+// listed
+int kemeny_batch(const char **inputs, int ninputs, const KemenyMethod **sel, int nsel, FILE *out);
+
+// Write s to out as a JSON string literal (see batch.c)
+void json_string(FILE *out, const char *s);
+
+// The election files batch mode would run for inputs, sorted
+// by path; -1 if an input cannot be listed
+int kemeny_list_elections(const char **inputs, int ninputs, char ***paths);
+
 #endif
@@ -0,0 +1,224 @@
+// readranks.c
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "ranksfile.h"
+
+//----------------------------------------------------------
+// Helper function: grow
+//----------------------------------------------------------
+// Makes sure a heap array has room for at least need items,
+// doubling its capacity as required. Exits on failure.
+//----------------------------------------------------------
+static void *grow(void *arr, int *cap, int need, size_t itemsize) {
+    if (need <= *cap) return arr;
+    int newcap = *cap ? *cap : 16;
+    while (newcap < need) newcap *= 2;
+    void *bigger = realloc(arr, (size_t)newcap * itemsize);
+    if (!bigger) {
+        fprintf(stderr, "Out of memory while reading input!\n");
+        exit(1);
+    }
+    *cap = newcap;
+    return bigger;
+}
+
+//----------------------------------------------------------
+// Function: read_ranks_file
+//----------------------------------------------------------
+// Reads voter rankings from an input file.
+// Returns a RanksFile sized for exactly the candidates and
+// voters found, with candidate names and the pairwise
+// preference matrix filled in.
+//
+// The input is memory-mapped and scanned once in place:
+// each token is interned in a hash table of candidate names
+// straight from the mapped bytes, and every ballot is kept
+// only as a list of candidate indices. The RanksFile is
+// created when the final counts are known, and the matrix
+// is then built in bulk (see ranksfile_add_ballots).
+//
+// Parameters:
+// - path: input file, or NULL for stdin
+// - outfile: output stream (for printing info), NULL for none
+// - showinput: if nonzero, prints each input line read
+//----------------------------------------------------------
+RanksFile *read_ranks_file(const char *path, FILE *outfile, int showinput) {
+    MappedFile in;
+    NameTable names;                         // Candidate names seen so far
+    BallotSet ballots;                       // All ballots as candidate indices
+    int *onevote = NULL;                     // Candidate indices of the current line
+    int nvotes, votecap = 0;
+
+    if (!map_file(path, &in)) {
+        fprintf(stderr, "Cannot read %s\n", path ? path : "standard input");
+        return NULL;
+    }
+    if (!nametable_init(&names, 16)) {
+        fprintf(stderr, "Out of memory while reading input!\n");
+        exit(1);
+    }
+    ballotset_init(&ballots);
+
+    // Scan the input until EOF, one ballot per line
+    const char *p = in.data, *end = in.data + in.len;
+    while (p < end) {
+        const char *line = p;
+        const char *token;
+        size_t len;
+        int r;
+        nvotes = 0;
+
+        // Process each token (candidate name)
+        while ((r = next_token(&p, end, &token, &len)) == 1) {
+            int idx = nametable_intern(&names, token, len); // Index of known or new candidate
+            if (idx == -1) {
+                fprintf(stderr, "Out of memory while reading input!\n");
+                exit(1);
+            }
+
+            onevote = grow(onevote, &votecap, nvotes + 1, sizeof(int));
+            onevote[nvotes++] = idx;  // Store candidate index for this ranking
+        }
+
+        // Optionally print the line read
+        if (showinput)
+            fwrite(line, 1, p - line, outfile);
+
+        // One voter processed
+        if (!ballotset_add(&ballots, onevote, NULL, nvotes, 1)) {
+            fprintf(stderr, "Out of memory while reading input!\n");
+            exit(1);
+        }
+    }
+    unmap_file(&in);
+    free(onevote);
+
+    RanksFile *rf = ranksfile_create(names.count, ballots.nballots);
+    if (!rf) {
+        fprintf(stderr, "Out of memory for %d candidates and %d voters!\n", names.count, ballots.nballots);
+        exit(1);
+    }
+    ranksfile_adopt_names(rf, &names);  // rf now owns the name table
+
+    // Update preference matrix based on rankings
+    rf->nballots = ballots.nballots;
+    if (!ranksfile_add_ballots(rf, &ballots)) {
+        fprintf(stderr, "Out of memory while building the preference matrix!\n");
+        exit(1);
+    }
+    ballotset_free(&ballots);
+
+    // Print summary
+    if (outfile) fprintf(outfile, "*** There are %d candidates and %d voters. ***\n", rf->ncands, rf->nrankers);
+    return rf;
+}
+
+typedef struct {
+    long long pos;
+    int cand;
+} Placed;
+
+static int by_pos(const void *a, const void *b) {
+    const Placed *x = a, *y = b;
+    if (x->pos != y->pos) return (x->pos < y->pos) ? -1 : 1;
+    return x->cand - y->cand;
+}
+
+//----------------------------------------------------------
+// Function: ranksfile_from_positions
+//----------------------------------------------------------
+// Builds a RanksFile from a voters x candidates array of
+// rank positions, pos(v,c) being the place of candidate c
+// on ballot v (lower is better), as produced by the Python
+// loaders and generators. The array is read in place through
+// its strides: element (v,c) is the itemsize-byte signed
+// integer (1, 2, 4 or 8) at data + v * vstride + c * cstride,
+// so any row-major, column-major or sliced array can be
+// passed without a copy.
+//
+// A row that is a permutation of 0 .. ncands-1 is inverted
+// directly. Any other row (1-based, a column slice of a
+// larger election, repeated values) is sorted by position
+// instead, candidates with equal positions being tied.
+// Candidates are named "0" .. "n-1" and the matrix is built
+// in bulk with opts (NULL for the defaults). Returns NULL if
+// memory runs out.
+//----------------------------------------------------------
+RanksFile *ranksfile_from_positions(const void *data, int itemsize, ptrdiff_t vstride, ptrdiff_t cstride,
+                                    int nvoters, int ncands, const KemenyOptions *opts) {
+    const char *base = data;
+    int sz = ncands > 0 ? ncands : 1;
+    NameTable names;
+    BallotSet ballots;
+    int *order = malloc(sz * sizeof(int));
+    int *levels = malloc(sz * sizeof(int));
+    Placed *placed = malloc(sz * sizeof(Placed));
+    RanksFile *rf = NULL;
+    char name[16];
+
+    ballotset_init(&ballots);
+    if (!order || !levels || !placed || !nametable_init(&names, ncands > 16 ? ncands : 16)) {
+        free(order);
+        free(levels);
+        free(placed);
+        return NULL;
+    }
+    for (int c = 0; c < ncands; c++) {
+        int len = snprintf(name, sizeof(name), "%d", c);
+        if (nametable_intern(&names, name, len) != c) goto fail;
+    }
+
+    for (int v = 0; v < nvoters; v++) {
+        const char *row = base + v * vstride;
+        int direct = 1;
+        for (int c = 0; c < ncands; c++) order[c] = -1;
+        for (int c = 0; c < ncands; c++) {
+            const char *item = row + c * cstride;
+            long long pos;
+            switch (itemsize) {
+            case 1: pos = *(const int8_t *)item; break;
+            case 2: pos = *(const int16_t *)item; break;
+            case 4: pos = *(const int32_t *)item; break;
+            default: pos = *(const int64_t *)item; break;
+            }
+            placed[c] = (Placed){ pos, c };
+            if (direct && pos >= 0 && pos < ncands && order[pos] < 0) order[pos] = c;
+            else direct = 0;
+        }
+
+        int ok;
+        if (direct) {
+            ok = ballotset_add(&ballots, order, NULL, ncands, 1);
+        } else {
+            qsort(placed, ncands, sizeof(Placed), by_pos);
+            for (int i = 0; i < ncands; i++) {
+                order[i] = placed[i].cand;
+                levels[i] = (i > 0 && placed[i].pos == placed[i - 1].pos) ? levels[i - 1] : i;
+            }
+            ok = ballotset_add(&ballots, order, levels, ncands, 1);
+        }
+        if (!ok) goto fail;
+    }
+
+    rf = ranksfile_create(ncands, nvoters);
+    if (!rf) goto fail;
+    if (opts) rf->opts = *opts;
+    ranksfile_adopt_names(rf, &names);   // rf now owns the name table
+    rf->nballots = nvoters;
+    if (!ranksfile_add_ballots(rf, &ballots)) goto fail;
+    ballotset_free(&ballots);
+    free(order);
+    free(levels);
+    free(placed);
+    return rf;
+
+fail:
+    if (rf) ranksfile_destroy(rf);   // Owns the name table by now
+    else nametable_free(&names);
+    ballotset_free(&ballots);
+    free(order);
+    free(levels);
+    free(placed);
+    return NULL;
+}
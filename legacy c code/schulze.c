@@ -0,0 +1,183 @@
+// schulze.c
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "ranksfile.h"
+
+//-----------------------------------------------------
+// Schulze method (beatpath)
+//-----------------------------------------------------
+// The link a -> b has strength m(a,b) when a beats b by a
+// strict majority, none (0) otherwise. p(a,b) is the
+// strength of the strongest path, its weakest link
+// maximized, found by the max-min closure
+//
+//   p(j,k) = max(p(j,k), min(p(j,i), p(i,k)))   for each i.
+//
+// a beats b when p(a,b) > p(b,a); the ranking sorts by the
+// number of candidates each one beats, then by Borda score,
+// then by index, so it has no ties and can seed the local
+// search.
+//
+// The closure is the blocked Floyd-Warshall: the matrix is
+// cut into SCHULZE_TILE x SCHULZE_TILE tiles, and for each
+// diagonal tile k it
+//   1. closes tile (k,k) by itself,
+//   2. updates the rest of row k and column k through it,
+//   3. updates every other tile (i,j) from (i,k) and (k,j).
+// Each tile update works on three tiles that fit in L1 and
+// runs its inner loop over a contiguous row (vectorized
+// min/max). Tiles of phases 2 and 3 are independent and are
+// split across threads.
+//-----------------------------------------------------
+
+#define SCHULZE_TILE 64
+#define SCHULZE_PARALLEL_MIN 256     // Fewer candidates: one thread
+
+typedef struct {
+    int *p;               // Padded N x N strength matrix
+    int N;                // n rounded up to a whole tile
+    int nb;               // Tiles per side
+    int kb;               // Current diagonal tile
+    int phase;            // 2 or 3
+    int worker;
+    int nworkers;
+} SchulzeTask;
+
+// c(i,j) = max(c(i,j), min(a(i,k), b(k,j))) over the tile, k
+// outermost, so a and b may be c itself (phases 1 and 2)
+static void tile_update(int *c, const int *a, const int *b, int stride) {
+    for (int k = 0; k < SCHULZE_TILE; k++) {
+        const int *bk = &b[(size_t)k * stride];
+        for (int i = 0; i < SCHULZE_TILE; i++) {
+            int aik = a[(size_t)i * stride + k];
+            if (aik == 0) continue;
+            int *ci = &c[(size_t)i * stride];
+            for (int j = 0; j < SCHULZE_TILE; j++) {
+                int v = aik < bk[j] ? aik : bk[j];
+                ci[j] = ci[j] > v ? ci[j] : v;
+            }
+        }
+    }
+}
+
+#define TILE(t, i, j) (&(t)->p[((size_t)(i) * (t)->N + (size_t)(j)) * SCHULZE_TILE])
+
+static void *schulze_worker(void *arg) {
+    SchulzeTask *t = arg;
+    int nb = t->nb, kb = t->kb;
+
+    if (t->phase == 2) {
+        // Row kb and column kb, without the diagonal tile
+        for (int x = t->worker; x < 2 * nb; x += t->nworkers) {
+            int m = x >> 1;
+            if (m == kb) continue;
+            if (x & 1) tile_update(TILE(t, m, kb), TILE(t, m, kb), TILE(t, kb, kb), t->N);
+            else tile_update(TILE(t, kb, m), TILE(t, kb, kb), TILE(t, kb, m), t->N);
+        }
+    } else {
+        for (int x = t->worker; x < nb * nb; x += t->nworkers) {
+            int i = x / nb, j = x % nb;
+            if (i == kb || j == kb) continue;
+            tile_update(TILE(t, i, j), TILE(t, i, kb), TILE(t, kb, j), t->N);
+        }
+    }
+    return NULL;
+}
+
+typedef struct {
+    int wins;
+    long long borda;
+    int cand;
+} SchulzeRank;
+
+static int by_wins_desc(const void *a, const void *b) {
+    const SchulzeRank *x = a, *y = b;
+    if (x->wins != y->wins) return y->wins - x->wins;
+    if (x->borda != y->borda) return (x->borda < y->borda) ? 1 : -1;
+    return x->cand - y->cand;
+}
+
+//-----------------------------------------------------
+// Fills perm with the Schulze ranking and returns its
+// Kemeny score, or KEMENY_NO_SCORE if out of memory
+//-----------------------------------------------------
+long long schulze_solve(RanksFile *rf, int *perm) {
+    int n = rf->ncands;
+    int nb = (n + SCHULZE_TILE - 1) / SCHULZE_TILE;
+    int N = nb * SCHULZE_TILE;
+    const Tournament *tour = ranksfile_tournament(rf);
+    int *p = calloc((size_t)N * N + 1, sizeof(int));
+    SchulzeRank *sr = malloc((n > 0 ? n : 1) * sizeof(SchulzeRank));
+    SchulzeTask *tasks = NULL;
+    if (!tour || !p || !sr) {
+        free(p);
+        free(sr);
+        return KEMENY_NO_SCORE;
+    }
+
+    // Link strengths; padding rows and columns stay 0
+    for (int a = 0; a < n; a++) {
+        const int *row = &PREF(rf, a, 0);
+        int *pa = &p[(size_t)a * N];
+        for (int b = 0; b < n; b++) pa[b] = row[b] > 0 ? row[b] : 0;
+    }
+
+    int nworkers = n >= SCHULZE_PARALLEL_MIN ? ranksfile_threads(rf) : 1;
+    if (nworkers > (nb - 1) * (nb - 1)) nworkers = (nb - 1) * (nb - 1);
+    if (nworkers < 1) nworkers = 1;
+    tasks = malloc(nworkers * sizeof(SchulzeTask));
+    if (!tasks) nworkers = 0;
+
+    SchulzeTask one = { p, N, nb, 0, 0, 0, 1 };
+    for (int kb = 0; kb < nb; kb++) {
+        one.kb = kb;
+        tile_update(TILE(&one, kb, kb), TILE(&one, kb, kb), TILE(&one, kb, kb), N);
+        for (int phase = 2; phase <= 3; phase++) {
+            if (nworkers <= 1) {
+                one.phase = phase;
+                schulze_worker(&one);
+                continue;
+            }
+            for (int w = 0; w < nworkers; w++)
+                tasks[w] = (SchulzeTask){ p, N, nb, kb, phase, w, nworkers };
+            run_parallel(schulze_worker, tasks, sizeof(SchulzeTask), nworkers);
+        }
+    }
+    free(tasks);
+
+    // Count beatpath wins
+    for (int a = 0; a < n; a++) {
+        int w = 0;
+        for (int b = 0; b < n; b++)
+            w += p[(size_t)a * N + b] > p[(size_t)b * N + a];
+        sr[a] = (SchulzeRank){ w, tour->borda[a], a };
+    }
+    qsort(sr, n, sizeof(SchulzeRank), by_wins_desc);
+
+    for (int i = 0; i < n; i++) perm[i] = sr[i].cand;
+    long long score = ranking_score(rf, perm);
+    free(p);
+    free(sr);
+    return score;
+}
+
+void compute_schulze(RanksFile *rf, FILE *outfile) {
+    int n = rf->ncands;
+    int *ranking = malloc(sizeof(int) * (n > 0 ? n : 1));
+    long long score = ranking ? schulze_solve(rf, ranking) : KEMENY_NO_SCORE;
+
+    if (score == KEMENY_NO_SCORE) {
+        fprintf(outfile, "\nSchulze: out of memory.\n");
+        free(ranking);
+        return;
+    }
+
+    fprintf(outfile, "\nSchulze (beatpath) ranking (score = %lld): ", score);
+    for (int i = 0; i < n; i++) {
+        fprintf(outfile, "%s ", rf->unnames[ranking[i]]);
+    }
+    fprintf(outfile, "\n");
+
+    free(ranking);
+}
@@ -0,0 +1,33 @@
+# setup.py -- builds the _kemeny Python extension (see kemeny_module.c)
+#
+#   python3 setup.py build_ext --inplace
+#
+# compiles every solver source with the bindings into one
+# shared library; kemeny_native.py (next to algorithms.py)
+# finds it in this directory.
+from setuptools import Extension, setup
+
+# The solver library; kemeny.c, kemeny_angle.c,
+# kemeny_bench.c and generate_votes.c are command-line programs
+LIBRARY_SOURCES = [
+    "ranksfile.c", "readranks.c", "mapfile.c", "preflib.c", "cache.c", "merge.c",
+    "margin.c", "components.c", "tournament.c", "methods.c",
+    "kemeny_bruteforce.c", "kemeny_dp.c", "kemeny_bnb.c", "kemeny_heuristic.c",
+    "kemeny_multistart.c", "kemeny_anneal.c",
+    "borda_heuristic.c", "copeland.c", "rankedpairs.c", "schulze.c", "quicksort.c",
+    "stream.c", "batch.c",
+]
+
+setup(
+    name="kemeny-native",
+    version="1.0",
+    ext_modules=[
+        Extension(
+            "_kemeny",
+            sources=LIBRARY_SOURCES + ["kemeny_module.c"],
+            extra_compile_args=["-O3", "-pthread"],
+            extra_link_args=["-pthread"],
+            libraries=["m"],
+        )
+    ],
+)
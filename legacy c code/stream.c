@@ -0,0 +1,325 @@
+// stream.c
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "ranksfile.h"
+
+#ifndef _WIN32
+#include <errno.h>
+#include <signal.h>
+#include <unistd.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/un.h>
+#endif
+
+//----------------------------------------------------------
+// Streaming mode
+//----------------------------------------------------------
+// A long-running election that ballots keep arriving at. The
+// preference matrix stays resident: each ballot of k
+// candidates is applied as its k(k-1)/2 pair updates, and
+// the cached margins and tournament are corrected on those
+// pairs alone (ranksfile_update). Candidates seen for the
+// first time get a new row and column (ranksfile_grow).
+//
+// The consensus is kept between requests. The first one is
+// the heuristic solver's (see kemeny_solve); every later one
+// starts from the previous ranking, places each candidate
+// that appeared since at its best position, and runs one
+// local-search descent from there. One ballot rarely moves
+// the optimum much, so the descent usually stops after a
+// pass or two instead of the many a cold start needs.
+//
+// Input is line based, from a pipe (stdin) or from the
+// clients of a Unix domain socket one at a time:
+//   a b c ...    a ballot, best candidate first
+//   !consensus   re-optimize and print the consensus
+//   !quit        stop serving
+// Blank lines are ignored. A ballot naming a candidate twice
+// is rejected with a message.
+//----------------------------------------------------------
+
+void stream_init(KemenyStream *ks, RanksFile *rf) {
+    memset(ks, 0, sizeof(KemenyStream));
+    ks->rf = rf;
+}
+
+void stream_free(KemenyStream *ks) {
+    free(ks->perm);
+    memset(ks, 0, sizeof(KemenyStream));
+}
+
+//----------------------------------------------------------
+// Helper: insert_best
+//----------------------------------------------------------
+// Inserts c into the ranking perm[0..m) where it gains the
+// most. With c placed at p, the score counts m(x,c) for the
+// x above it and m(c,x) for the x below, so moving it one
+// place down, past x = perm[p], adds 2 m(x,c): one O(m)
+// sweep finds the best place.
+//----------------------------------------------------------
+static void insert_best(const RanksFile *rf, int *perm, int m, int c) {
+    long long gain = 0, best = 0;
+    int bestp = 0;
+    for (int p = 0; p < m; p++) {
+        gain += 2LL * PREF(rf, perm[p], c);
+        if (gain > best) {
+            best = gain;
+            bestp = p + 1;
+        }
+    }
+    memmove(&perm[bestp + 1], &perm[bestp], (m - bestp) * sizeof(int));
+    perm[bestp] = c;
+}
+
+//----------------------------------------------------------
+// Function: stream_consensus
+//----------------------------------------------------------
+// Re-optimizes the consensus of ks->rf, warm-started from
+// the previous one, and returns its Kemeny score (ks->perm
+// holds the ranking), or KEMENY_NO_SCORE if out of memory.
+//----------------------------------------------------------
+long long stream_consensus(KemenyStream *ks) {
+    RanksFile *rf = ks->rf;
+    int n = rf->ncands;
+
+    if (n > ks->cap) {
+        int cap = ks->cap ? ks->cap : 16;
+        while (cap < n) cap *= 2;
+        int *bigger = realloc(ks->perm, cap * sizeof(int));
+        if (!bigger) return KEMENY_NO_SCORE;
+        ks->perm = bigger;
+        ks->cap = cap;
+    }
+
+    long long score;
+    if (ks->nperm == 0) {
+        score = n > 0 ? kemeny_solve(rf, heuristic_kemeny_solve, ks->perm) : 0;
+    } else {
+        for (int c = ks->nperm; c < n; c++) insert_best(rf, ks->perm, c, c);
+        score = local_search_kemeny(rf, ks->perm);
+    }
+
+    // A failed solve may leave perm half written: start cold next time
+    ks->nperm = score == KEMENY_NO_SCORE ? 0 : n;
+    ks->score = score;
+    ks->pending = 0;
+    return score;
+}
+
+static void print_consensus(KemenyStream *ks, FILE *out) {
+    double t0 = monotonic_ms();
+    long long score = stream_consensus(ks);
+    double ms = monotonic_ms() - t0;
+
+    if (score == KEMENY_NO_SCORE) {
+        fprintf(out, "Consensus: out of memory.\n");
+    } else {
+        RanksFile *rf = ks->rf;
+        fprintf(out, "Consensus of %d voters on %d candidates (score = %lld, %.1f ms): ",
+                rf->nrankers, rf->ncands, score, ms);
+        for (int i = 0; i < rf->ncands; i++) fprintf(out, "%s ", rf->unnames[ks->perm[i]]);
+        fprintf(out, "\n");
+    }
+    fflush(out);
+}
+
+//----------------------------------------------------------
+// Helper: read_line
+//----------------------------------------------------------
+// Reads one line of any length into *buf (grown as needed).
+// Returns its length, or -1 at the end of the input.
+//----------------------------------------------------------
+static long read_line(FILE *in, char **buf, size_t *cap) {
+    size_t len = 0;
+    for (;;) {
+        if (*cap - len < 2) {
+            size_t newcap = *cap ? 2 * *cap : 256;
+            char *bigger = realloc(*buf, newcap);
+            if (!bigger) {
+                fprintf(stderr, "Out of memory while reading input!\n");
+                exit(1);
+            }
+            *buf = bigger;
+            *cap = newcap;
+        }
+        if (!fgets(*buf + len, (int)(*cap - len), in)) return len > 0 ? (long)len : -1;
+        len += strlen(*buf + len);
+        if ((*buf)[len - 1] == '\n') return (long)len;
+    }
+}
+
+//----------------------------------------------------------
+// Function: stream_serve
+//----------------------------------------------------------
+// Processes the lines of in until its end or a !quit line,
+// answering on out. Returns 1 after !quit, 0 at the end of
+// the input, or -1 if in cannot be read or memory runs out
+// (the election may then hold part of the last ballot).
+//----------------------------------------------------------
+int stream_serve(KemenyStream *ks, FILE *in, FILE *out) {
+    RanksFile *rf = ks->rf;
+    char *line = NULL;
+    size_t linecap = 0;
+    int *ballot = NULL;           // Candidate indices of the current ballot
+    const char **tokens = NULL;   // Its names, in the line buffer
+    size_t *lens = NULL;
+    int ballotcap = 0;
+    int quit = 0;
+    long len;
+
+    while (!quit && (len = read_line(in, &line, &linecap)) >= 0) {
+        const char *p = line, *end = line + len;
+        const char *token;
+        size_t tlen;
+
+        if (next_token(&p, end, &token, &tlen) != 1) continue;   // Blank line
+        if (token[0] == '!') {
+            if (tlen == 10 && strncmp(token, "!consensus", 10) == 0) {
+                print_consensus(ks, out);
+            } else if (tlen == 5 && strncmp(token, "!quit", 5) == 0) {
+                quit = 1;
+            } else {
+                fprintf(out, "Unknown command '%.*s' (commands are !consensus and !quit)\n", (int)tlen, token);
+                fflush(out);
+            }
+            continue;
+        }
+
+        // Collect the names, rejecting a ballot that repeats one
+        // before any new name is interned
+        int k = 0, dup = -1;
+        do {
+            if (k == ballotcap) {
+                ballotcap = ballotcap ? 2 * ballotcap : 64;
+                int *bigger = realloc(ballot, ballotcap * sizeof(int));
+                const char **tbigger = realloc(tokens, ballotcap * sizeof(char *));
+                size_t *lbigger = realloc(lens, ballotcap * sizeof(size_t));
+                if (bigger) ballot = bigger;
+                if (tbigger) tokens = tbigger;
+                if (lbigger) lens = lbigger;
+                if (!bigger || !tbigger || !lbigger) {
+                    fprintf(stderr, "Out of memory while reading input!\n");
+                    quit = -1;
+                    goto done;
+                }
+            }
+            for (int i = 0; i < k && dup < 0; i++)
+                if (lens[i] == tlen && memcmp(tokens[i], token, tlen) == 0) dup = i;
+            tokens[k] = token;
+            lens[k++] = tlen;
+        } while (next_token(&p, end, &token, &tlen) == 1);
+        if (dup >= 0) {
+            fprintf(out, "Ignored ballot: %.*s is listed twice\n", (int)lens[dup], tokens[dup]);
+            fflush(out);
+            continue;
+        }
+
+        for (int i = 0; i < k; i++) {
+            ballot[i] = nametable_intern(&rf->names, tokens[i], lens[i]);
+            if (ballot[i] == -1) {
+                fprintf(stderr, "Out of memory while reading input!\n");
+                quit = -1;
+                goto done;
+            }
+        }
+        rf->unnames = rf->names.names;   // Interning may have moved the array
+        if (rf->names.count > rf->ncands && !ranksfile_grow(rf, rf->names.count)) {
+            fprintf(stderr, "Out of memory for %d candidates!\n", rf->names.count);
+            quit = -1;
+            goto done;
+        }
+
+        ranksfile_update(rf, ballot, NULL, k, 1);
+        ks->pending++;
+        if (ks->refresh_every > 0 && ks->pending >= ks->refresh_every) print_consensus(ks, out);
+    }
+    if (!quit && ferror(in)) {
+        perror("Error reading ballots");
+        quit = -1;
+    }
+
+done:
+    free(line);
+    free(ballot);
+    free(tokens);
+    free(lens);
+    return quit;
+}
+
+//----------------------------------------------------------
+// Function: stream_listen
+//----------------------------------------------------------
+// Serves the clients of a Unix domain socket at path, one
+// connection at a time, each with stream_serve, until one
+// sends !quit. Answers go back to the client that asked.
+// An existing file at path is replaced only if it is a
+// socket (one left behind by an earlier run). Returns 0, or
+// -1 if the socket cannot be set up, serving a client fails
+// (see stream_serve) or on Windows, where this mode is not
+// available.
+//----------------------------------------------------------
+int stream_listen(KemenyStream *ks, const char *path, FILE *log) {
+#ifndef _WIN32
+    struct sockaddr_un addr;
+    if (strlen(path) >= sizeof(addr.sun_path)) {
+        fprintf(stderr, "Socket path too long: %s\n", path);
+        return -1;
+    }
+    memset(&addr, 0, sizeof(addr));
+    addr.sun_family = AF_UNIX;
+    strcpy(addr.sun_path, path);
+
+    struct stat st;
+    if (lstat(path, &st) == 0) {
+        if (!S_ISSOCK(st.st_mode)) {
+            fprintf(stderr, "Cannot listen on %s: it exists and is not a socket\n", path);
+            return -1;
+        }
+        unlink(path);   // A socket left behind by an earlier run
+    }
+
+    int fd = socket(AF_UNIX, SOCK_STREAM, 0);
+    if (fd < 0) {
+        perror("socket");
+        return -1;
+    }
+    if (bind(fd, (struct sockaddr *)&addr, sizeof(addr)) < 0 || listen(fd, 8) < 0) {
+        perror(path);
+        close(fd);
+        return -1;
+    }
+    signal(SIGPIPE, SIG_IGN);   // A client that hangs up must not end the server
+    fprintf(log, "Listening on %s\n", path);
+    fflush(log);
+
+    int quit = 0, status = 0;
+    while (!quit) {
+        int c = accept(fd, NULL, NULL);
+        if (c < 0) {
+            if (errno == EINTR) continue;
+            perror("accept");
+            break;
+        }
+        int c2 = dup(c);
+        FILE *in = fdopen(c, "r");
+        FILE *out = c2 >= 0 ? fdopen(c2, "w") : NULL;
+        if (in && out) quit = stream_serve(ks, in, out);
+        else perror("fdopen");
+        if (quit < 0) status = -1;
+        if (in) fclose(in);
+        else close(c);
+        if (out) fclose(out);
+        else if (c2 >= 0) close(c2);
+    }
+    close(fd);
+    unlink(path);
+    return status;
+#else
+    (void)ks;
+    (void)log;
+    fprintf(stderr, "Cannot listen on %s: Unix domain sockets are not available\n", path);
+    return -1;
+#endif
+}
@@ -0,0 +1,126 @@
+// tournament.c
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "ranksfile.h"
+#include "bitset.h"
+
+//----------------------------------------------------------
+// Majority tournament
+//----------------------------------------------------------
+// The pairwise-majority methods only need to know, for each
+// pair, who wins the majority contest (or that it is tied),
+// plus a couple of per-candidate totals. The tournament keeps
+// that in bit rows:
+//
+//   wins[a]  bit b set if m(a,b) > 0
+//   ties[a]  bit b set if m(a,b) == 0, b != a
+//
+// with the Borda and Copeland scores of every candidate. It
+// is derived from prefmat in one pass and cached in the
+// RanksFile (ranksfile_tournament), so running several rules
+// on one election reads the full matrix only once; after
+// that a rule is a sort plus bit tests and popcounts.
+//----------------------------------------------------------
+
+//----------------------------------------------------------
+// Function: tournament_create
+//----------------------------------------------------------
+// Builds the tournament of rf. Returns NULL if memory
+// cannot be allocated.
+//----------------------------------------------------------
+Tournament *tournament_create(const RanksFile *rf) {
+    int n = rf->ncands;
+    int nw = BITSET_WORDS(n);
+    Tournament *t = calloc(1, sizeof(Tournament));
+    if (!t) return NULL;
+
+    t->n = n;
+    t->nwords = nw;
+    t->wins = calloc((size_t)n * nw + 1, sizeof(uint64_t));
+    t->ties = calloc((size_t)n * nw + 1, sizeof(uint64_t));
+    t->borda = calloc(n > 0 ? n : 1, sizeof(long long));
+    t->copeland2 = calloc(n > 0 ? n : 1, sizeof(int));
+    if (!t->wins || !t->ties || !t->borda || !t->copeland2) {
+        tournament_destroy(t);
+        return NULL;
+    }
+
+    for (int a = 0; a < n; a++) {
+        const int *row = &PREF(rf, a, 0);
+        uint64_t *w = &t->wins[(size_t)a * nw];
+        uint64_t *z = &t->ties[(size_t)a * nw];
+
+        // Branch-free, so the compiler can vectorize both loops
+        long long b = 0;
+        for (int j = 0; j < n; j++) b += row[j] > 0 ? row[j] : 0;
+        for (int q = 0; q < nw; q++) {
+            int lo = q * 64, hi = lo + 64 < n ? lo + 64 : n;
+            uint64_t wm = 0, zm = 0;
+            for (int j = lo; j < hi; j++) {
+                wm |= (uint64_t)(row[j] > 0) << (j - lo);
+                zm |= (uint64_t)(row[j] == 0) << (j - lo);
+            }
+            w[q] = wm;
+            z[q] = zm;
+        }
+        z[a >> 6] &= ~((uint64_t)1 << (a & 63));   // A candidate does not tie itself
+
+        t->borda[a] = b;
+        t->copeland2[a] = 2 * bitset_count(w, nw) + bitset_count(z, nw);
+    }
+    return t;
+}
+
+// Wins and ties of a against b, as counted by copeland2
+static inline int copeland_points(int m) {
+    return m > 0 ? 2 : (m == 0);
+}
+
+//----------------------------------------------------------
+// Function: tournament_update
+//----------------------------------------------------------
+// Brings t up to date after ranksfile_add_ballot added the
+// ballot cands[0..k) (levels, weight as passed to it) to rf.
+// Only the ballot's own pairs changed, each margin by exactly
+// weight, so their bits and the Borda and Copeland scores of
+// their candidates are corrected in O(k^2).
+//----------------------------------------------------------
+void tournament_update(Tournament *t, const RanksFile *rf, const int *cands, const int *levels, int k,
+                       int weight) {
+    int nw = t->nwords;
+    for (int i = 0; i < k - 1; i++) {
+        for (int j = i + 1; j < k; j++) {
+            if (levels && levels[i] == levels[j]) continue;   // Tied, no change
+            int a = cands[i], b = cands[j];
+            int now = PREF(rf, a, b), before = now - weight;
+
+            t->borda[a] += (now > 0 ? now : 0) - (before > 0 ? before : 0);
+            t->borda[b] += (now < 0 ? -now : 0) - (before < 0 ? -before : 0);
+            t->copeland2[a] += copeland_points(now) - copeland_points(before);
+            t->copeland2[b] += copeland_points(-now) - copeland_points(-before);
+
+            uint64_t *wa = &t->wins[(size_t)a * nw], *za = &t->ties[(size_t)a * nw];
+            uint64_t *wb = &t->wins[(size_t)b * nw], *zb = &t->ties[(size_t)b * nw];
+            bit_clear(wa, b);
+            bit_clear(za, b);
+            bit_clear(wb, a);
+            bit_clear(zb, a);
+            if (now > 0) bit_set(wa, b);
+            else if (now < 0) bit_set(wb, a);
+            else {
+                bit_set(za, b);
+                bit_set(zb, a);
+            }
+        }
+    }
+}
+
+void tournament_destroy(Tournament *t) {
+    if (!t) return;
+    free(t->wins);
+    free(t->ties);
+    free(t->borda);
+    free(t->copeland2);
+    free(t);
+}
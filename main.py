@@ -1,5 +1,5 @@
 import numpy as np
-from algorithms import (
+from kemeny_native import (
     kemeny_young_exact,
     borda,
     copeland,